@@ -0,0 +1,172 @@
+#include "alloc_stats.h"
+
+#include <atomic>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#endif
+
+namespace {
+
+std::atomic<size_t> g_current_bytes(0);
+std::atomic<size_t> g_peak_bytes(0);
+std::atomic<size_t> g_allocations(0);
+std::atomic<size_t> g_frees(0);
+
+void UpdatePeak(const size_t bytes) {
+  size_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+  while (bytes > peak &&
+         !g_peak_bytes.compare_exchange_weak(peak, bytes,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+#ifdef WMC_ALLOC_STATS
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __EMSCRIPTEN__
+#define WMC_REAL_MALLOC emscripten_builtin_malloc
+#define WMC_REAL_FREE emscripten_builtin_free
+#define WMC_REAL_MEMALIGN emscripten_builtin_memalign
+#else
+extern "C" {
+void *__libc_malloc(size_t size);
+void __libc_free(void *ptr);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+#define WMC_REAL_MALLOC __libc_malloc
+#define WMC_REAL_FREE __libc_free
+#define WMC_REAL_MEMALIGN __libc_memalign
+#endif
+
+namespace {
+
+void *Track(void *ptr) {
+  if (ptr != nullptr) {
+    const size_t size = malloc_usable_size(ptr);
+    UpdatePeak(g_current_bytes.fetch_add(size, std::memory_order_relaxed) +
+               size);
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  return ptr;
+}
+
+void Untrack(void *ptr) {
+  if (ptr != nullptr) {
+    g_current_bytes.fetch_sub(malloc_usable_size(ptr),
+                              std::memory_order_relaxed);
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace
+
+// Every entry point that hands out memory freed by free() must be wrapped,
+// otherwise free() would subtract sizes that were never added. calloc and
+// realloc are built on malloc, the allocator has no public versions of
+// them that bypass the wrappers in every toolchain.
+extern "C" {
+
+void *malloc(size_t size) { return Track(WMC_REAL_MALLOC(size)); }
+
+void free(void *ptr) {
+  Untrack(ptr);
+  WMC_REAL_FREE(ptr);
+}
+
+void *calloc(size_t n, size_t size) {
+  if (size != 0 && n > static_cast<size_t>(-1) / size) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+  void *ptr = malloc(n * size);
+  if (ptr != nullptr) {
+    memset(ptr, 0, n * size);
+  }
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return malloc(size);
+  }
+  if (size == 0) {
+    free(ptr);
+    return nullptr;
+  }
+  const size_t old_size = malloc_usable_size(ptr);
+  if (size <= old_size) {
+    return ptr;
+  }
+  void *res = malloc(size);
+  if (res != nullptr) {
+    memcpy(res, ptr, old_size);
+    free(ptr);
+  }
+  return res;
+}
+
+void *memalign(size_t alignment, size_t size) {
+  return Track(WMC_REAL_MEMALIGN(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **res, size_t alignment, size_t size) {
+  if (alignment % sizeof(void *) != 0 ||
+      (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void *ptr = memalign(alignment, size);
+  if (ptr == nullptr) {
+    return ENOMEM;
+  }
+  *res = ptr;
+  return 0;
+}
+
+#ifndef __EMSCRIPTEN__
+void *valloc(size_t size) { return memalign(sysconf(_SC_PAGESIZE), size); }
+
+void *pvalloc(size_t size) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  return memalign(page, (size + page - 1) / page * page);
+}
+#endif
+}
+
+bool AllocStatsEnabled() { return true; }
+
+#else
+
+bool AllocStatsEnabled() { return false; }
+
+#endif  // WMC_ALLOC_STATS
+
+AllocStats CurrentAllocStats() {
+  AllocStats res;
+  res.current_bytes = g_current_bytes.load(std::memory_order_relaxed);
+  res.peak_bytes = g_peak_bytes.load(std::memory_order_relaxed);
+  res.allocations = g_allocations.load(std::memory_order_relaxed);
+  res.frees = g_frees.load(std::memory_order_relaxed);
+#ifdef __EMSCRIPTEN__
+  res.heap_size = emscripten_get_heap_size();
+#endif
+  return res;
+}
+
+size_t ResetPeakAllocBytes() {
+  return g_peak_bytes.exchange(g_current_bytes.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+}
+
+void RestorePeakAllocBytes(const size_t peak) { UpdatePeak(peak); }
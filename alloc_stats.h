@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Allocation accounting of the whole process. With WMC_ALLOC_STATS, malloc
+// and friends are wrapped (over __libc_* natively and
+// emscripten_builtin_* in wasm), which also covers operator new. Sizes are
+// the usable sizes of the blocks, i.e. what the allocator really hands out.
+struct AllocStats {
+  size_t current_bytes = 0;
+  size_t peak_bytes = 0;
+  size_t allocations = 0;
+  size_t frees = 0;
+  // the size of the wasm memory, which only grows, 0 natively
+  size_t heap_size = 0;
+};
+
+// false if malloc is not wrapped in this build, the stats are all 0
+bool AllocStatsEnabled();
+
+AllocStats CurrentAllocStats();
+
+// Start a new peak at the current usage and return the old peak, so that
+// the peak of a phase can be measured. RestorePeakAllocBytes(old peak) at
+// the end of the phase makes the peak the overall one again.
+size_t ResetPeakAllocBytes();
+void RestorePeakAllocBytes(size_t peak);
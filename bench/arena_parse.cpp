@@ -0,0 +1,99 @@
+// Parse + destroy time and allocation counts of ModelProto, on the heap
+// versus on the arena used by the export entry points (onnx_arena.h).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "onnx_arena.h"
+#include "tools/model_gen.h"
+
+static std::atomic<size_t> g_new_calls{0};
+static std::atomic<size_t> g_delete_calls{0};
+
+void *operator new(size_t size) {
+  g_new_calls++;
+  void *p = malloc(size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  if (p != nullptr) {
+    g_delete_calls++;
+  }
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+struct Stat {
+  double ms;
+  size_t news;
+  size_t deletes;
+};
+
+template <typename F>
+static Stat Measure(F &&func, const int repeat) {
+  std::vector<double> times;
+  size_t news = 0;
+  size_t deletes = 0;
+  for (int i = 0; i < repeat; i++) {
+    const size_t new_calls = g_new_calls;
+    const size_t delete_calls = g_delete_calls;
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+    news = g_new_calls - new_calls;
+    deletes = g_delete_calls - delete_calls;
+  }
+  std::sort(times.begin(), times.end());
+  return {times[times.size() / 2], news, deletes};
+}
+
+int main(int argc, char **argv) {
+  const int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+  const std::vector<std::pair<int, size_t>> cases = {
+      {1000, 64}, {10000, 64}, {50000, 64}, {1000, 256 * 1024}};
+
+  printf("%8s %10s %12s | %10s %10s %10s | %10s %10s %10s\n", "nodes",
+         "weight", "model bytes", "heap ms", "new", "delete", "arena ms",
+         "new", "delete");
+  for (const auto &c : cases) {
+    std::string bytes;
+    MakeWeightedChain(c.first, c.second, ModelGenOptions())
+        .SerializeToString(&bytes);
+
+    const auto heap = Measure(
+        [&bytes]() {
+          onnx::ModelProto model;
+          if (!model.ParseFromArray(bytes.data(), bytes.size())) {
+            abort();
+          }
+        },
+        repeat);
+    const auto arena = Measure(
+        [&bytes]() {
+          google::protobuf::Arena arena(ModelArenaOptions(bytes.size()));
+          auto *model =
+              google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
+          if (!model->ParseFromArray(bytes.data(), bytes.size())) {
+            abort();
+          }
+        },
+        repeat);
+    printf("%8d %10zu %12zu | %10.2f %10zu %10zu | %10.2f %10zu %10zu\n",
+           c.first, c.second, bytes.size(), heap.ms, heap.news, heap.deletes,
+           arena.ms, arena.news, arena.deletes);
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+// A minimal benchmark harness in the spirit of google-benchmark, so that
+// the benchmarks build anywhere the exporter does, with no dependency and
+// no network. Every benchmark runs at least --repeat times and until
+// --min-time-ms has passed; the median and the fastest iteration are
+// reported, with the throughput if the benchmark processes a known number
+// of bytes per iteration.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+class BenchSuite {
+ public:
+  using Fn = std::function<void()>;
+
+  // `setup` runs before every iteration of `run` and is not timed, e.g. to
+  // copy an input that `run` takes over. `bytes` is what one iteration
+  // processes, 0 if there is no throughput to report.
+  void Add(const std::string &name, const size_t bytes, Fn run,
+           Fn setup = nullptr) {
+    benches_.push_back({name, bytes, std::move(run), std::move(setup)});
+  }
+
+  // [--filter SUBSTR] [--repeat N] [--min-time-ms MS] [--json FILE],
+  // returns the exit code of the program
+  int Main(int argc, char **argv) {
+    std::string filter;
+    std::string json_path;
+    int repeat = 5;
+    double min_time_ms = 200;
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (i + 1 == argc) {
+        return Usage(argv[0]);
+      }
+      if (arg == "--filter") {
+        filter = argv[++i];
+      } else if (arg == "--repeat") {
+        repeat = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--min-time-ms") {
+        min_time_ms = std::atof(argv[++i]);
+      } else if (arg == "--json") {
+        json_path = argv[++i];
+      } else {
+        return Usage(argv[0]);
+      }
+    }
+
+    printf("%-48s %8s %12s %12s %12s\n", "benchmark", "iters", "median ms",
+           "min ms", "MB/s");
+    std::string json = "[";
+    for (auto &bench : benches_) {
+      if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+        continue;
+      }
+      const auto res = Run(bench, repeat, min_time_ms);
+      const double mb_per_s =
+          bench.bytes == 0 ? 0 : bench.bytes / 1e3 / res.median_ms;
+      char throughput[32] = "-";
+      if (bench.bytes != 0) {
+        snprintf(throughput, sizeof(throughput), "%.1f", mb_per_s);
+      }
+      printf("%-48s %8d %12.3f %12.3f %12s\n", bench.name.c_str(),
+             res.iterations, res.median_ms, res.min_ms, throughput);
+      fflush(stdout);
+      char buf[256];
+      snprintf(buf, sizeof(buf),
+               "\", \"iterations\": %d, \"median_ms\": %.4f, \"min_ms\": "
+               "%.4f, \"bytes\": %zu, \"mb_per_s\": %.2f}",
+               res.iterations, res.median_ms, res.min_ms, bench.bytes,
+               mb_per_s);
+      json += (json.size() == 1 ? "" : ", ") + std::string("{\"name\": \"") +
+              bench.name + buf;
+    }
+    json += "]\n";
+    if (!json_path.empty()) {
+      FILE *fp = fopen(json_path.c_str(), "wb");
+      if (fp == nullptr ||
+          fwrite(json.data(), 1, json.size(), fp) != json.size()) {
+        fprintf(stderr, "cannot write %s\n", json_path.c_str());
+        if (fp != nullptr) {
+          fclose(fp);
+        }
+        return 1;
+      }
+      fclose(fp);
+    }
+    return 0;
+  }
+
+ private:
+  struct Bench {
+    std::string name;
+    size_t bytes;
+    Fn run;
+    Fn setup;
+  };
+  struct Result {
+    int iterations;
+    double median_ms;
+    double min_ms;
+  };
+
+  static int Usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--filter SUBSTR] [--repeat N] [--min-time-ms MS] "
+            "[--json FILE]\n",
+            argv0);
+    return 2;
+  }
+
+  static Result Run(Bench &bench, const int repeat, const double min_time_ms) {
+    // one untimed warm-up iteration, e.g. for lazily created globals
+    if (bench.setup) {
+      bench.setup();
+    }
+    bench.run();
+    std::vector<double> times;
+    double total_ms = 0;
+    while (static_cast<int>(times.size()) < repeat || total_ms < min_time_ms) {
+      if (bench.setup) {
+        bench.setup();
+      }
+      const auto start = std::chrono::steady_clock::now();
+      bench.run();
+      const auto end = std::chrono::steady_clock::now();
+      times.push_back(
+          std::chrono::duration<double, std::milli>(end - start).count());
+      total_ms += times.back();
+    }
+    std::sort(times.begin(), times.end());
+    return {static_cast<int>(times.size()), times[times.size() / 2],
+            times[0]};
+  }
+
+  std::vector<Bench> benches_;
+};
@@ -0,0 +1,168 @@
+// The passes and entry points of the exporter core on chain models of
+// increasing size and on a ResNet and a transformer (see
+// tools/model_gen.h): parsing and serializing
+// ModelProto, add_initer_to_inputs, check_static_input_size_export,
+// onnxsimplify_export with and without verification and onnx2tnn_export.
+// Native only, it links wmc_core like wmc-export.
+//
+//   exporter_bench [--filter onnxsim] [--repeat 5] [--json out.json]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench/bench.h"
+#include "export.h"
+#include "log.h"
+#include "onnx_passes.h"
+#include "tools/model_gen.h"
+
+namespace {
+
+struct Case {
+  std::string name;
+  onnx::ModelProto model;
+  // onnx2tnn_export is only run on the operators every tnn build converts
+  bool tnn;
+};
+
+std::vector<Case> MakeCases() {
+  const ModelGenOptions options;
+  std::vector<Case> cases;
+  // many small messages, then a model of mostly weights
+  const std::pair<int, size_t> chains[] = {
+      {100, 16 * 1024}, {1000, 16 * 1024}, {10000, 64}, {200, 1024 * 1024}};
+  for (const auto &c : chains) {
+    cases.push_back({"chain" + std::to_string(c.first) + "x" +
+                         std::to_string(c.second),
+                     MakeWeightedChain(c.first, c.second, options), true});
+  }
+  // the shapes of real models: ResNet-18, and a small BERT-like encoder
+  cases.push_back({"resnet18", MakeResNetLike(2, 64, 224, options), true});
+  cases.push_back(
+      {"transformer4x256", MakeTransformerLike(4, 256, 4, 128, options),
+       false});
+  return cases;
+}
+
+// A new ctx and a copy of the model as its input for every iteration, the
+// exporters take their input over
+struct ExportFixture {
+  const std::string *bytes;
+  WasmBuffer *ctx = nullptr;
+  unsigned char *input = nullptr;
+
+  explicit ExportFixture(const std::string *bytes) : bytes(bytes) {}
+  ExportFixture(const ExportFixture &) = delete;
+  ExportFixture &operator=(const ExportFixture &) = delete;
+  ~ExportFixture() { Reset(); }
+
+  void Reset() {
+    if (ctx != nullptr) {
+      free_exporter(ctx);
+      ctx = nullptr;
+    }
+  }
+  void Setup() {
+    Reset();
+    ctx = create_exporter();
+    begin_input(ctx, bytes->size());
+    memcpy(append_input(ctx, bytes->size()), bytes->data(), bytes->size());
+    input = end_input(ctx);
+    if (input == nullptr) {
+      abort();
+    }
+  }
+  void Check(const bool ok) {
+    if (!ok) {
+      fprintf(stderr, "export failed: %.*s\n",
+              static_cast<int>(get_buffer_size3(ctx)),
+              reinterpret_cast<const char *>(get_buffer3(ctx)));
+      abort();
+    }
+  }
+};
+
+std::string CaseName(const char *what, const Case &c) {
+  return std::string(what) + "/" + c.name;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // the result cache would turn every iteration after the first into a
+  // lookup
+  result_cache_set_capacity(0);
+  exporter_set_log_level(kLogError);
+
+  // kept alive until the suite has run, the benchmarks refer to them
+  std::vector<std::unique_ptr<std::string>> models;
+  std::vector<std::unique_ptr<ExportFixture>> fixtures;
+  BenchSuite suite;
+  for (const auto &c : MakeCases()) {
+    models.emplace_back(new std::string);
+    const std::string *bytes = models.back().get();
+    c.model.SerializeToString(models.back().get());
+    const size_t len = bytes->size();
+
+    suite.Add(CaseName("parse", c), len, [bytes]() {
+      onnx::ModelProto model;
+      if (!model.ParseFromArray(bytes->data(), bytes->size())) {
+        abort();
+      }
+    });
+
+    auto parsed = std::make_shared<onnx::ModelProto>();
+    parsed->ParseFromString(*bytes);
+    suite.Add(CaseName("serialize", c), len, [parsed]() {
+      std::string out;
+      parsed->SerializeToString(&out);
+    });
+
+    auto initer_model = std::make_shared<onnx::ModelProto>();
+    suite.Add(
+        CaseName("add_initer_to_inputs", c), 0,
+        [initer_model]() { add_initer_to_inputs(*initer_model); },
+        [initer_model, parsed]() { *initer_model = *parsed; });
+
+    fixtures.emplace_back(new ExportFixture(bytes));
+    auto *f = fixtures.back().get();
+    suite.Add(
+        CaseName("check_static_input_size_export", c), len,
+        [f]() {
+          f->Check(check_static_input_size_export(f->ctx, f->input,
+                                                  f->bytes->size()) == 2);
+        },
+        [f]() { f->Setup(); });
+    suite.Add(
+        CaseName("onnxsimplify_export", c), len,
+        [f]() {
+          f->Check(onnxsimplify_export(f->ctx, f->input, f->bytes->size(),
+                                       true, nullptr, 0));
+        },
+        [f]() {
+          f->Setup();
+          exporter_set_verification(f->ctx, kVerifyOff, 0, 0);
+        });
+    suite.Add(
+        CaseName("onnxsimplify_export+verify", c), len,
+        [f]() {
+          f->Check(onnxsimplify_export(f->ctx, f->input, f->bytes->size(),
+                                       true, nullptr, 0));
+        },
+        [f]() { f->Setup(); });
+    if (c.tnn) {
+      suite.Add(
+          CaseName("onnx2tnn_export", c), len,
+          [f]() {
+            f->Check(onnx2tnn_export(f->ctx, f->input, f->bytes->size()));
+          },
+          [f]() { f->Setup(); });
+    }
+  }
+  return suite.Main(argc, argv);
+}
@@ -0,0 +1,98 @@
+// add_initer_to_inputs and the "is this input an initializer" check of
+// check_static_input_size_export, with the previous linear name searches
+// versus GraphIndex, on chain models whose initializers are all listed in
+// graph.input as older exporters do. The linear versions are quadratic
+// there.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "graph_index.h"
+#include "onnx_passes.h"
+#include "tools/model_gen.h"
+
+static void add_initer_to_inputs_linear(onnx::ModelProto &model) {
+  std::vector<std::string> input_names;
+  for (const auto &x : model.graph().input()) {
+    input_names.push_back(x.name());
+  }
+  for (const auto &x : model.graph().initializer()) {
+    if (std::find(input_names.begin(), input_names.end(), x.name()) ==
+        input_names.end()) {
+      model.mutable_graph()->add_input()->set_name(x.name());
+    }
+  }
+}
+
+static int count_non_initer_inputs_linear(const onnx::ModelProto &model) {
+  int count = 0;
+  for (const auto &x : model.graph().input()) {
+    bool is_initer = false;
+    for (const auto &initer : model.graph().initializer()) {
+      if (x.name() == initer.name()) {
+        is_initer = true;
+        break;
+      }
+    }
+    count += !is_initer;
+  }
+  return count;
+}
+
+static int count_non_initer_inputs_indexed(const onnx::ModelProto &model) {
+  const GraphIndex index(model.graph());
+  int count = 0;
+  for (const auto &x : model.graph().input()) {
+    count += !index.IsInitializer(x.name());
+  }
+  return count;
+}
+
+template <typename F>
+static double TimeMs(F &&func) {
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main() {
+  printf("%10s | %12s %12s | %12s %12s | %12s\n", "initers", "add linear",
+         "add index", "check linear", "check index", "build index");
+  for (const int n : {1000, 10000, 50000}) {
+    auto model = MakeWeightedChain(n, 4, ModelGenOptions());
+    add_initer_to_inputs(model);
+
+    auto model1 = model;
+    auto model2 = model;
+    const double add_linear =
+        TimeMs([&model1]() { add_initer_to_inputs_linear(model1); });
+    const double add_index =
+        TimeMs([&model2]() { add_initer_to_inputs(model2); });
+    if (model1.graph().input_size() != model2.graph().input_size()) {
+      abort();
+    }
+
+    int count1 = 0;
+    int count2 = 0;
+    const double check_linear = TimeMs([&model, &count1]() {
+      count1 = count_non_initer_inputs_linear(model);
+    });
+    const double check_index = TimeMs([&model, &count2]() {
+      count2 = count_non_initer_inputs_indexed(model);
+    });
+    if (count1 != count2) {
+      abort();
+    }
+    const double build =
+        TimeMs([&model]() { const GraphIndex index(model.graph()); });
+
+    printf("%10d | %10.2fms %10.2fms | %10.2fms %10.2fms | %10.2fms\n", n,
+           add_linear, add_index, check_linear, check_index, build);
+  }
+  return 0;
+}
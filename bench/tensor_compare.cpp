@@ -0,0 +1,142 @@
+// CompareFloats, with the vector code of the build (SSE2 or simd128),
+// against CompareFloatsScalar: first whether they agree on NaN, infinities,
+// signed zeros and subnormals in every lane and in the scalar tail, then
+// both on random outputs. Exits with 1 before timing anything if they
+// disagree.
+//
+//   tensor_compare_bench [--filter vector] [--repeat 5] [--json out.json]
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench/bench.h"
+#include "tensor_compare.h"
+
+namespace {
+
+const float kInf = std::numeric_limits<float>::infinity();
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+
+// the dot products of the cosine are summed in another order
+bool SameDiff(const TensorDiff &x, const TensorDiff &y) {
+  const bool same_cosine =
+      (std::isnan(x.cosine) && std::isnan(y.cosine)) ||
+      std::fabs(x.cosine - y.cosine) <= 1e-6;
+  return x.count == y.count && x.violations == y.violations &&
+         x.nan_mismatches == y.nan_mismatches && x.max_abs == y.max_abs &&
+         x.max_rel == y.max_rel && x.max_ulp == y.max_ulp && same_cosine;
+}
+
+bool Check(const std::string &name, const std::vector<float> &a,
+           const std::vector<float> &b, const Tolerances &tol) {
+  TensorDiff vector, scalar;
+  CompareFloats(a.data(), b.data(), a.size(), tol, &vector);
+  CompareFloatsScalar(a.data(), b.data(), a.size(), tol, &scalar);
+  if (SameDiff(vector, scalar)) {
+    return true;
+  }
+  fprintf(stderr, "%s: the vector code differs from the scalar one\n%s\n%s\n",
+          name.c_str(), vector.ToJson().c_str(), scalar.ToJson().c_str());
+  return false;
+}
+
+// Pairs whose statistics are easy to get wrong in vector code. The first
+// one sets a large max_rel and max_ulp the later ones must not lose, e.g.
+// 1 against inf has a relative error of inf / inf = NaN.
+const float kSpecials[][2] = {
+    {3, 1},
+    {1, kInf},
+    {kInf, -kInf},
+    {kInf, kInf},
+    {-kInf, 1},
+    {kNaN, 1},
+    {1, kNaN},
+    {kNaN, kNaN},
+    {kNaN, kInf},
+    {-0.f, 0.f},
+    {std::numeric_limits<float>::denorm_min(), 0},
+    {FLT_MAX, -FLT_MAX},
+    {FLT_MIN, -FLT_MIN},
+};
+
+bool CheckSpecials(const Tolerances &tol) {
+  const size_t kCount = sizeof(kSpecials) / sizeof(kSpecials[0]);
+  bool ok = true;
+  // all pairs in every lane, with 3 elements of scalar tail
+  for (size_t lane = 0; lane < 4; lane++) {
+    const size_t n = (kCount + 1) * 4 + 3;
+    std::vector<float> a(n, 1.f), b(n, 1.f);
+    for (size_t i = 0; i < kCount; i++) {
+      a[i * 4 + lane] = kSpecials[i][0];
+      b[i * 4 + lane] = kSpecials[i][1];
+    }
+    ok = Check("specials in lane " + std::to_string(lane), a, b, tol) && ok;
+  }
+  // each pair alone after the first one in the same lane, so that a later
+  // pair cannot restore what it lost
+  for (size_t i = 1; i < kCount; i++) {
+    for (size_t lane = 0; lane < 4; lane++) {
+      std::vector<float> a(8 + 3, 1.f), b(8 + 3, 1.f);
+      a[lane] = kSpecials[0][0];
+      b[lane] = kSpecials[0][1];
+      a[4 + lane] = kSpecials[i][0];
+      b[4 + lane] = kSpecials[i][1];
+      ok = Check("special " + std::to_string(i) + " in lane " +
+                     std::to_string(lane),
+                 a, b, tol) &&
+           ok;
+    }
+  }
+  return ok;
+}
+
+// the outputs of the original model (b) and of a simplified one (a) that
+// is off by rounding, with a few real errors and specials
+void MakeOutputs(const size_t n, std::vector<float> *a,
+                 std::vector<float> *b) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+  a->resize(n);
+  b->resize(n);
+  for (size_t i = 0; i < n; i++) {
+    (*b)[i] = uniform(rng);
+    (*a)[i] = (*b)[i] * (1 + uniform(rng) * 1e-6f);
+    if (i % 1009 == 0) {
+      (*a)[i] += 0.1f;
+    } else if (i % 4099 == 0) {
+      const auto &pair = kSpecials[i % (sizeof(kSpecials) /
+                                        sizeof(kSpecials[0]))];
+      (*a)[i] = pair[0];
+      (*b)[i] = pair[1];
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Tolerances tol;
+  tol.min_cosine = 0.99;
+  tol.max_ulp = 16;
+  std::vector<float> a, b;
+  MakeOutputs((1 << 20) + 3, &a, &b);
+  if (!CheckSpecials(tol) || !Check("random", a, b, tol)) {
+    return 1;
+  }
+
+  TensorDiff diff;
+  BenchSuite suite;
+  const size_t bytes = 2 * a.size() * sizeof(float);
+  suite.Add("compare_floats/vector/1M", bytes, [&]() {
+    CompareFloats(a.data(), b.data(), a.size(), tol, &diff);
+  });
+  suite.Add("compare_floats/scalar/1M", bytes, [&]() {
+    CompareFloatsScalar(a.data(), b.data(), a.size(), tol, &diff);
+  });
+  return suite.Main(argc, argv);
+}
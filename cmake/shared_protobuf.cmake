@@ -0,0 +1,66 @@
+# Emscripten dynamic linking of protobuf and onnx (WMC_SHARED_PROTOBUF).
+#
+# Every converter links protobuf statically, and the exporters onnx as well,
+# so a page that runs several converters downloads the same code once per
+# converter. In this mode they are side modules instead:
+#   libwmc_protobuf.wasm  the protobuf runtime
+#   libwmc_onnx.wasm      the onnx protos, checker and shape inference,
+#                         which needs libwmc_protobuf.wasm
+# built by the main project, and the converters are main modules which load
+# them at startup from next to their own .wasm. The browser downloads each
+# side module once for all converters.
+#
+# The pthread builds (tengine_wrapper, paddle_wrapper) keep their static
+# protobuf: dynamic linking of pthread builds is not reliable in
+# emscripten, and paddle builds a patched protobuf of its own.
+#
+# Every object of a dynamically linked program has to be position
+# independent, so include this file before any target is added. The
+# wrappers link the side modules of the main project, pass its build
+# directory as WMC_SIDE_MODULE_DIR. Their protobuf (CMAKE_PREFIX_PATH) only
+# provides the headers and protoc then, and has to be the version of
+# third_party/onnxruntime/cmake/external/protobuf.
+
+option(WMC_SHARED_PROTOBUF "Link protobuf and onnx from side modules (emscripten only)" OFF)
+set(WMC_SIDE_MODULE_DIR "" CACHE PATH "Where libwmc_protobuf.wasm and libwmc_onnx.wasm are, the build directory of the main project")
+
+if (EMSCRIPTEN AND WMC_SHARED_PROTOBUF)
+    add_compile_options(-fPIC)
+endif()
+
+# Makes target a main module which loads the side modules of targets
+# wmc_protobuf and wmc_onnx (lib<name>.wasm in WMC_SIDE_MODULE_DIR) given
+# after it, a side module itself stays one and only records them as
+# needed. Call it after the LINK_FLAGS of target are set. No-op unless
+# WMC_SHARED_PROTOBUF is on.
+function(link_side_modules target)
+    if (NOT (EMSCRIPTEN AND WMC_SHARED_PROTOBUF))
+        return()
+    endif()
+    if (NOT WMC_SIDE_MODULE_DIR)
+        message(FATAL_ERROR "WMC_SHARED_PROTOBUF needs WMC_SIDE_MODULE_DIR")
+    endif()
+    # The side modules come first on the command line, before the objects
+    # and the static libraries of target. The symbols they define are not
+    # undefined anymore when the linker gets to libprotobuf.a and libonnx.a,
+    # so nothing is taken from those.
+    set(side_modules "")
+    foreach(name ${ARGN})
+        set(path ${WMC_SIDE_MODULE_DIR}/lib${name}.wasm)
+        set(side_modules "${side_modules} ${path}")
+        set_property(TARGET ${target} APPEND PROPERTY LINK_DEPENDS ${path})
+        if (TARGET ${name})
+            add_dependencies(${target} ${name})
+        endif()
+    endforeach()
+    get_target_property(flags ${target} LINK_FLAGS)
+    if (NOT flags)
+        set(flags "")
+    endif()
+    # MAIN_MODULE=2 keeps only what the main module and its side modules use
+    if (NOT flags MATCHES "SIDE_MODULE")
+        set(side_modules "-s MAIN_MODULE=2${side_modules}")
+    endif()
+    string(STRIP "${side_modules} ${flags}" flags)
+    set_target_properties(${target} PROPERTIES LINK_FLAGS "${flags}")
+endfunction()
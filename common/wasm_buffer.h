@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using Buffer = std::pair<void *, size_t>;
+
+// What an output of an exporter is. The numbers are part of the js api
+// (see result_kind), so only append to it.
+enum WasmResultKind : int32_t {
+  // onnx model, ncnn param, tnn proto, ...
+  kResultModel = 0,
+  // ncnn bin, tnn model, ...
+  kResultWeights = 1,
+  // error or warning message
+  kResultMessage = 2,
+  // statistics of the passes run by the exporter as a json object
+  kResultStats = 3,
+  // what was verified after simplifying and how, as a json object
+  kResultVerification = 4,
+  // the time spent in every phase of the exporter as a json object
+  kResultTiming = 5,
+  // the same as a chrome trace
+  kResultTrace = 6,
+  // the allocated bytes at every phase boundary as a json object, see
+  // alloc_stats.h
+  kResultMemory = 7,
+  // the log entries of the exporter, one per line, see log.h
+  kResultLog = 8,
+};
+
+// How much of a simplified model is verified against the original one.
+// Part of the js api like WasmResultKind.
+enum VerifyPolicy : int32_t {
+  kVerifyOff = 0,
+  // the simplified model passes the onnx checker and has the same inputs
+  // and outputs as the original one
+  kVerifyStructural = 1,
+  // structural, then up to verify_runs runs of both models on random
+  // inputs within verify_budget_ms
+  kVerifySampled = 2,
+  // structural, then verify_runs runs regardless of the budget
+  kVerifyFull = 3,
+};
+
+// Options of the exporters, set on a ctx before running one of them
+struct ExportOptions {
+  // see DedupeInitializers in onnx_passes.h
+  bool dedupe_initializers = false;
+  int32_t verify_policy = kVerifyFull;
+  int32_t verify_runs = 1;
+  // 0 for no limit
+  double verify_budget_ms = 0;
+  // see Tolerances in tensor_compare.h
+  double verify_abs_tol = 1e-5;
+  double verify_rel_tol = 1e-4;
+  double verify_min_cosine = 0;
+  uint32_t verify_max_ulp = 0;
+};
+
+struct WasmResult {
+  int32_t kind;
+  const unsigned char *data;
+  size_t size;
+  // keeps the storage behind `data` alive, whatever it is
+  std::shared_ptr<void> owner;
+};
+
+// A model pushed into the wasm heap piece by piece, see begin_input
+struct WasmInput {
+  unsigned char *data;
+  size_t size;
+  size_t filled;
+};
+
+// The context of an exporter. It owns the inputs pushed by js and every
+// output of a conversion until free_exporter is called, so that js can read
+// them from the wasm heap. Outputs are adopted, never copied.
+struct WasmBuffer {
+  std::vector<WasmInput> inputs;
+  std::vector<WasmResult> results;
+  ExportOptions options;
+
+  WasmBuffer() = default;
+  WasmBuffer(const WasmBuffer &) = delete;
+  WasmBuffer &operator=(const WasmBuffer &) = delete;
+  ~WasmBuffer() {
+    for (const auto &x : inputs) {
+      free(x.data);
+    }
+  }
+
+  // start a new input of `size` bytes, returns nullptr if out of memory
+  unsigned char *beginInput(const size_t size) {
+    // malloc(0) may return nullptr
+    auto *data = static_cast<unsigned char *>(malloc(size == 0 ? 1 : size));
+    if (data == nullptr) {
+      return nullptr;
+    }
+    inputs.push_back({data, size, 0});
+    return data;
+  }
+  // reserve the next `len` bytes of the current input, the caller writes
+  // them to the returned address
+  unsigned char *appendInput(const size_t len) {
+    if (inputs.empty()) {
+      return nullptr;
+    }
+    auto &input = inputs.back();
+    if (len > input.size - input.filled) {
+      return nullptr;
+    }
+    auto *dst = input.data + input.filled;
+    input.filled += len;
+    return dst;
+  }
+  // returns the complete current input, or drops it and returns nullptr if
+  // fewer bytes than announced were appended
+  unsigned char *endInput() {
+    if (inputs.empty()) {
+      return nullptr;
+    }
+    const auto &input = inputs.back();
+    if (input.filled != input.size) {
+      free(input.data);
+      inputs.pop_back();
+      return nullptr;
+    }
+    return input.data;
+  }
+  // free an input as soon as the exporter does not need it anymore.
+  // Returns false if `data` is not an input of this ctx.
+  bool releaseInput(const void *data) {
+    for (auto it = inputs.begin(); it != inputs.end(); ++it) {
+      if (it->data == data) {
+        free(it->data);
+        inputs.erase(it);
+        return true;
+      }
+    }
+    return false;
+  }
+  // stop owning an input whose ownership was taken by someone else
+  void detachInput(const void *data) {
+    for (auto it = inputs.begin(); it != inputs.end(); ++it) {
+      if (it->data == data) {
+        inputs.erase(it);
+        return;
+      }
+    }
+  }
+
+  size_t resultCount() const { return results.size(); }
+
+  const WasmResult *result(const size_t i) const {
+    return i < results.size() ? &results[i] : nullptr;
+  }
+
+  const WasmResult *findResult(const int32_t kind) const {
+    for (const auto &x : results) {
+      if (x.kind == kind) {
+        return &x;
+      }
+    }
+    return nullptr;
+  }
+
+  // adopt any object that owns `size` bytes at `data`, e.g. a protobuf
+  // message whose bytes field is the output
+  template <typename T>
+  void addResult(const int32_t kind, std::unique_ptr<T> owner,
+                 const void *data, const size_t size) {
+    WasmResult res;
+    res.kind = kind;
+    res.data = static_cast<const unsigned char *>(data);
+    res.size = size;
+    res.owner = std::shared_ptr<T>(std::move(owner));
+    results.push_back(std::move(res));
+  }
+  void addResult(const int32_t kind, std::string &&str) {
+    // the string object is moved onto the heap first, so that the pointer
+    // of a short (SSO) string stays valid
+    std::unique_ptr<std::string> owner(new std::string(std::move(str)));
+    const void *data = owner->data();
+    const size_t size = owner->size();
+    addResult(kind, std::move(owner), data, size);
+  }
+  void addResult(const int32_t kind, void *buf, const size_t buflen) {
+    // we own the buf, it must be allocated by malloc
+    WasmResult res;
+    res.kind = kind;
+    res.data = static_cast<const unsigned char *>(buf);
+    res.size = buflen;
+    res.owner = std::shared_ptr<void>(buf, free);
+    results.push_back(std::move(res));
+  }
+  void addResult(const int32_t kind, Buffer buf) {
+    addResult(kind, buf.first, buf.second);
+  }
+
+  // copy at most len bytes of the i-th output starting at offset into dst,
+  // returns the number of bytes copied
+  size_t readResult(const size_t i, const size_t offset, void *dst,
+                    const size_t len) const {
+    const auto *res = result(i);
+    if (res == nullptr || res->data == nullptr || offset >= res->size) {
+      return 0;
+    }
+    const size_t n = std::min(len, res->size - offset);
+    memcpy(dst, res->data + offset, n);
+    return n;
+  }
+
+  // free the storage of the i-th output once its reader is done with it.
+  // The entry itself is kept (with size 0) so that indices stay valid.
+  void releaseResult(const size_t i) {
+    if (i < results.size()) {
+      results[i].owner.reset();
+      results[i].data = nullptr;
+      results[i].size = 0;
+    }
+  }
+
+  void freeResult(const int32_t kind) {
+    for (auto it = results.begin(); it != results.end();) {
+      if (it->kind == kind) {
+        it = results.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // like addResult, but replaces the previous output of the same kind
+  template <typename... Args>
+  void setResult(const int32_t kind, Args &&... args) {
+    freeResult(kind);
+    addResult(kind, std::forward<Args>(args)...);
+  }
+
+  void freeBuffers() { results.clear(); }
+
+  // The fixed three slots that exporters used before the result table
+  void setBuffer1(Buffer buf) { setResult(kResultModel, buf); }
+  void setBuffer1(void *buf, const size_t buflen) {
+    setResult(kResultModel, buf, buflen);
+  }
+  void setBuffer1(std::string str) { setResult(kResultModel, std::move(str)); }
+  void setBuffer2(Buffer buf) { setResult(kResultWeights, buf); }
+  void setBuffer2(void *buf, const size_t buflen) {
+    setResult(kResultWeights, buf, buflen);
+  }
+  void setBuffer2(std::string str) {
+    setResult(kResultWeights, std::move(str));
+  }
+  void setBuffer3(std::string str) {
+    setResult(kResultMessage, std::move(str));
+  }
+};
@@ -0,0 +1,213 @@
+#include "content_hash.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace {
+
+const uint64_t kPrime1 = 11400714785074694791ULL;
+const uint64_t kPrime2 = 14029467366897019727ULL;
+const uint64_t kPrime3 = 1609587929392839161ULL;
+const uint64_t kPrime4 = 9650029242287828579ULL;
+const uint64_t kPrime5 = 2870177450012600261ULL;
+
+inline uint64_t Rotl(const uint64_t x, const int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// unaligned little-endian loads, both wasm and x86/arm64 are little-endian
+inline uint64_t Read64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t Round(uint64_t acc, const uint64_t input) {
+  acc += input * kPrime2;
+  acc = Rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t Merge(uint64_t acc, const uint64_t val) {
+  acc ^= Round(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+// the keys of the lanes of HashStripes
+const uint64_t kStripeKeys[8] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL,
+    0x1f67b3b7a4a44072ULL, 0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL,
+    0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+};
+
+// The four vectors of a stripe are spelled out, so that the accumulators
+// stay in registers without relying on the optimizer to unroll
+#if defined(__SSE2__)
+inline __m128i Accumulate(const __m128i acc, const unsigned char *p,
+                          const __m128i key) {
+  const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  const __m128i data_key = _mm_xor_si128(data, key);
+  // low half times high half of every 64-bit lane
+  const __m128i product = _mm_mul_epu32(
+      data_key, _mm_shuffle_epi32(data_key, _MM_SHUFFLE(3, 3, 1, 1)));
+  const __m128i swapped = _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1));
+  return _mm_add_epi64(_mm_add_epi64(swapped, product),
+                       _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+inline __m128i Load(const uint64_t *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline void Store(uint64_t *p, const __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+#elif defined(__wasm_simd128__)
+inline v128_t Accumulate(const v128_t acc, const unsigned char *p,
+                         const v128_t key) {
+  const v128_t data = wasm_v128_load(p);
+  const v128_t data_key = wasm_v128_xor(data, key);
+  const v128_t product =
+      wasm_i64x2_mul(wasm_v128_and(data_key, wasm_i64x2_splat(0xffffffff)),
+                     wasm_u64x2_shr(data_key, 32));
+  const v128_t swapped = wasm_i32x4_shuffle(acc, acc, 1, 0, 3, 2);
+  return wasm_i64x2_add(wasm_i64x2_add(swapped, product),
+                        wasm_i64x2_shuffle(data, data, 1, 0));
+}
+
+inline v128_t Load(const uint64_t *p) { return wasm_v128_load(p); }
+
+inline void Store(uint64_t *p, const v128_t v) { wasm_v128_store(p, v); }
+#endif
+
+// The 8 64-bit lanes of StripeHash take the 8 words of every 64-byte
+// stripe, in the way of the XXH3 accumulator: a 32x32->64 multiply of the
+// word mixed with a key, plus the word of the neighbouring lane. The halves
+// of the lanes are swapped on every stripe so that the order of stripes
+// matters. Returns the end of the last full stripe.
+#if defined(__SSE2__) || defined(__wasm_simd128__)
+const unsigned char *HashStripes(const unsigned char *p,
+                                 const unsigned char *end, uint64_t *lanes) {
+  auto acc0 = Load(lanes), acc1 = Load(lanes + 2), acc2 = Load(lanes + 4),
+       acc3 = Load(lanes + 6);
+  const auto key0 = Load(kStripeKeys), key1 = Load(kStripeKeys + 2),
+             key2 = Load(kStripeKeys + 4), key3 = Load(kStripeKeys + 6);
+  for (; end - p >= 64; p += 64) {
+    acc0 = Accumulate(acc0, p, key0);
+    acc1 = Accumulate(acc1, p + 16, key1);
+    acc2 = Accumulate(acc2, p + 32, key2);
+    acc3 = Accumulate(acc3, p + 48, key3);
+  }
+  Store(lanes, acc0);
+  Store(lanes + 2, acc1);
+  Store(lanes + 4, acc2);
+  Store(lanes + 6, acc3);
+  return p;
+}
+#else
+const unsigned char *HashStripes(const unsigned char *p,
+                                 const unsigned char *end, uint64_t *lanes) {
+  for (; end - p >= 64; p += 64) {
+    for (int i = 0; i < 8; i++) {
+      const uint64_t data_key = Read64(p + 8 * i) ^ kStripeKeys[i];
+      const uint64_t product = (data_key & 0xffffffff) * (data_key >> 32);
+      lanes[i] = Rotl(lanes[i], 32) + product + Read64(p + 8 * (i ^ 1));
+    }
+  }
+  return p;
+}
+#endif
+
+}  // namespace
+
+uint64_t ContentHash(const void *data, const size_t len, const uint64_t seed) {
+  const auto *p = static_cast<const unsigned char *>(data);
+  const auto *const end = p + len;
+  uint64_t h;
+  if (len >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    const auto *const limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = Merge(h, v1);
+    h = Merge(h, v2);
+    h = Merge(h, v3);
+    h = Merge(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+  h += static_cast<uint64_t>(len);
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+    h = Rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= (*p) * kPrime5;
+    h = Rotl(h, 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t StripeHash(const void *data, const size_t len, const uint64_t seed) {
+  const auto *p = static_cast<const unsigned char *>(data);
+  const auto *const end = p + len;
+  uint64_t lanes[8];
+  for (int i = 0; i < 8; i++) {
+    lanes[i] = seed + i * kPrime2;
+  }
+  p = HashStripes(p, end, lanes);
+
+  // fold the lanes and the tail like ContentHash does
+  uint64_t h = seed + kPrime5 + static_cast<uint64_t>(len);
+  for (int i = 0; i < 8; i++) {
+    h ^= Round(0, lanes[i]);
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  for (; p + 8 <= end; p += 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  for (; p < end; p++) {
+    h ^= (*p) * kPrime5;
+    h = Rotl(h, 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 of len bytes at data. Several GB/s natively and uses native i64
+// arithmetic in wasm, so hashing a model costs a small fraction of parsing
+// it. Not a cryptographic hash.
+uint64_t ContentHash(const void *data, size_t len, uint64_t seed = 0);
+
+// A hash of 64-byte stripes in 8 independent lanes, computed with SSE2 on
+// x86, simd128 in wasm builds with WMC_WASM_SIMD and scalar code elsewhere,
+// all giving the same value. Meant for hashing many tensors whose matches
+// are confirmed byte by byte anyway, it is weaker than ContentHash.
+uint64_t StripeHash(const void *data, size_t len, uint64_t seed = 0);
@@ -3,167 +3,340 @@
 #include <onnxruntime/cmake/external/onnx/onnx/shape_inference/implementation.h>
 #include <onnxruntime/cmake/external/onnx/onnx/checker.h>
 
+#include <climits>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
-#include <iostream>
+#include <fstream>
 #include <string>
 
 #include <onnxruntime/test.h>
 
+#include "export.h"
+
 #include "onnx2tnn.h"
 
+#include "common/wasm_buffer.h"
 #include "dqx_helper.h"
+#include "graph_index.h"
+#include "log.h"
+#ifdef WMC_NCNN_PIPELINE
+#include "ncnn_pipeline.h"
+#endif
+#ifndef __EMSCRIPTEN__
+#include "external_data.h"
+#include "mapped_file.h"
+#endif
+#include "onnx_arena.h"
+#include "onnx_passes.h"
+#include "onnx_scanner.h"
+#include "phase_timer.h"
+#include "result_cache.h"
+#include "verify.h"
 #include "tengine/core/include/tengine_c_api.h"
 
 #define FOR(i, range) for (auto i = decltype(range)(0); i < range; i++)
 
-struct WasmBuffer {
-  unsigned char *output_buffer1 = nullptr;
-  unsigned char *output_buffer2 = nullptr;
-  unsigned char *output_buffer3 = nullptr;
-  size_t output_buffer_size1 = 0;
-  size_t output_buffer_size2 = 0;
-  size_t output_buffer_size3 = 0;
-
-  void freeBuffers() {
-    freeBuffer1();
-    freeBuffer2();
-    freeBuffer3();
+static const char *kCheckFailedMessage =
+    "The result is different after simplifying, sometimes it is "
+    "something wrong in onnx simplifier, but sometimes it is just "
+    "numerical error, please be careful to use the simplified model.";
+
+static std::string DedupeStatsJson(const DedupeStats &stats) {
+  return "{\"dedupe_initializers\": {\"removed\": " +
+         std::to_string(stats.removed) +
+         ", \"bytes_saved\": " + std::to_string(stats.bytes_saved) + "}}";
+}
+
+// The phases of an exporter, added to ctx as kResultTiming and kResultTrace
+// outputs on every way out of the exporter
+class ExportTimer : public PhaseTimer {
+ public:
+  explicit ExportTimer(WasmBuffer *ctx) : ctx_(ctx) {
+    // the log batches of the conversion are collected into kResultLog
+    SetLogSink(AppendLog, &log_, &prev_sink_, &prev_user_);
   }
-  void freeBuffer1() {
-    if (output_buffer1 != nullptr) {
-      free(output_buffer1);
-      output_buffer1 = nullptr;
-      output_buffer_size1 = 0;
+  ~ExportTimer() {
+    EndAll();
+    SetLogSink(prev_sink_, prev_user_);
+    try {
+      ctx_->setResult(kResultTiming, ToJson());
+      ctx_->setResult(kResultTrace, ToChromeTrace());
+      ctx_->setResult(kResultMemory, ToMemoryJson());
+      if (!log_.empty()) {
+        ctx_->setResult(kResultLog, std::move(log_));
+      }
+    } catch (const std::exception &) {
+      // out of memory, the timings are not worth failing the conversion
     }
   }
-  void freeBuffer2() {
-    if (output_buffer2 != nullptr) {
-      free(output_buffer2);
-      output_buffer2 = nullptr;
-      output_buffer_size2 = 0;
+
+ private:
+  static void AppendLog(const char *batch, const size_t len, void *user) {
+    try {
+      static_cast<std::string *>(user)->append(batch, len);
+    } catch (const std::exception &) {
     }
   }
-  void freeBuffer3() {
-    if (output_buffer3 != nullptr) {
-      free(output_buffer3);
-      output_buffer3 = nullptr;
-      output_buffer_size3 = 0;
+
+  WasmBuffer *ctx_;
+  std::string log_;
+  LogSink prev_sink_;
+  void *prev_user_;
+};
+
+// The part of onnxsimplify_export after parsing. The simplified model is
+// verified against the original one as ctx->options say, the report is a
+// kResultVerification output and a failure is a warning in kResultMessage.
+// cache_key is cleared if the numerical verification was not done, so that
+// the unverified output is not reused.
+static onnx::ModelProto SimplifyAndCheck(WasmBuffer *ctx, PhaseTimer *timer,
+                                         onnx::ModelProto &model,
+                                         const bool optimize,
+                                         const int32_t *input_shape,
+                                         const size_t input_shape_len,
+                                         std::string *cache_key) {
+  if (ctx->options.dedupe_initializers) {
+    PhaseScope phase(timer, "dedupe");
+    ctx->setResult(kResultStats, DedupeStatsJson(DedupeInitializers(model)));
+  }
+  timer->Begin("add_initer_to_inputs");
+  add_initer_to_inputs(model);
+  timer->End();
+  MyTensorShapeMap input_map;
+  const std::string input_name = GetInputNames(model)[0];
+  if (input_shape_len > 0) {
+    MyTensorShape shape;
+    FOR(i, input_shape_len) { shape.push_back(input_shape[i]); }
+    input_map[input_name] = shape;
+  }
+  for (const auto &x : input_map) {
+    std::string dims;
+    for (const auto &d : x.second) {
+      dims += (dims.empty() ? "" : ",") + std::to_string(d);
     }
+    WMC_DEBUG("input shape of %s: [%s]", x.first.c_str(), dims.c_str());
   }
-  void setBuffer1(Buffer buf) { setBuffer1(buf.first, buf.second); }
-  void setBuffer1(void *buf, const size_t buflen) {
-    // we own the buf
-    output_buffer1 = static_cast<unsigned char *>(buf);
-    output_buffer_size1 = buflen;
+
+  timer->Begin("simplify");
+  auto opt_model = Simplify(model, optimize, input_map);
+  timer->End();
+  VerifyReport report;
+  timer->Begin("verify");
+  const bool check = Verify(opt_model, model, input_map, ctx->options, &report);
+  timer->End();
+  if (!check) {
+    WMC_WARN("verification failed: %s", report.message.c_str());
+  } else if (report.numerical == "unverified") {
+    WMC_WARN("the simplified model is not verified numerically: %s",
+             report.message.c_str());
+    cache_key->clear();
+  } else {
+    WMC_INFO("verification ok");
   }
-  void setBuffer1(const std::string &str) {
-    output_buffer1 = static_cast<unsigned char *>(malloc(str.size()));
-    memcpy(output_buffer1, str.c_str(), str.size());
-    output_buffer_size1 = str.size();
+  ctx->setResult(kResultVerification, report.ToJson());
+  if (report.structural == "failed") {
+    ctx->setBuffer3("The simplified model fails the structural check (" +
+                    report.message +
+                    "), please be careful to use the simplified model.");
+  } else if (!check) {
+    // which outputs differ and by how much
+    ctx->setBuffer3(std::string(kCheckFailedMessage) + " (" + report.message +
+                    ")");
   }
-  void setBuffer2(Buffer buf) { setBuffer2(buf.first, buf.second); }
-  void setBuffer2(void *buf, const size_t buflen) {
-    // we own the buf
-    output_buffer2 = static_cast<unsigned char *>(buf);
-    output_buffer_size2 = buflen;
+  return opt_model;
+}
+
+// Everything but the input that changes the output of onnxsimplify
+static std::string OnnxSimOptions(const WasmBuffer *ctx, const bool optimize,
+                                  const int32_t *input_shape,
+                                  const size_t input_shape_len) {
+  std::string res = optimize ? "opt=1;shape=" : "opt=0;shape=";
+  FOR(i, input_shape_len) {
+    res += (i == 0 ? "" : ",") + std::to_string(input_shape[i]);
   }
-  void setBuffer2(const std::string &str) {
-    output_buffer2 = static_cast<unsigned char *>(malloc(str.size()));
-    memcpy(output_buffer2, str.c_str(), str.size());
-    output_buffer_size2 = str.size();
+  if (ctx->options.dedupe_initializers) {
+    res += ";dedupe=1";
   }
-  void setBuffer3(const std::string &str) {
-    output_buffer3 = static_cast<unsigned char *>(malloc(str.size()));
-    memcpy(output_buffer3, str.c_str(), str.size());
-    output_buffer_size3 = str.size();
+  // a cached conversion must have been verified the same way
+  const auto &options = ctx->options;
+  res += ";verify=" + std::to_string(options.verify_policy) + "," +
+         std::to_string(options.verify_runs) + "," +
+         std::to_string(options.verify_budget_ms) + "," +
+         std::to_string(options.verify_abs_tol) + "," +
+         std::to_string(options.verify_rel_tol) + "," +
+         std::to_string(options.verify_min_cosine) + "," +
+         std::to_string(options.verify_max_ulp);
+  return res;
+}
+
+// Add the outputs of an earlier identical conversion to ctx. `key` is set
+// for CacheConversion if the cache is enabled.
+static bool LookupConversion(WasmBuffer *ctx, const char *target,
+                             const void *buf, const size_t len,
+                             const std::string &options, std::string *key,
+                             int32_t *ret) {
+  auto &cache = GlobalResultCache();
+  if (!cache.enabled()) {
+    return false;
   }
-};
+  *key = ResultCache::Key(target, buf, len, options);
+  return cache.Lookup(*key, ctx, ret);
+}
+
+static void CacheConversion(const WasmBuffer *ctx, const std::string &key,
+                            const int32_t ret) {
+  if (!key.empty()) {
+    GlobalResultCache().Insert(key, *ctx, ret);
+  }
+}
 
 extern "C" {
 
-WasmBuffer *create_exporter() {
-  WasmBuffer *ctx;
+WasmBuffer *create_exporter() { return new WasmBuffer(); }
 
-  ctx = static_cast<WasmBuffer *>(malloc(sizeof(WasmBuffer)));
-  ctx->output_buffer_size1 = 0;
-  ctx->output_buffer_size2 = 0;
-  ctx->output_buffer_size3 = 0;
+void free_exporter(WasmBuffer *ctx) { delete ctx; }
 
-  return ctx;
+// Inputs are pushed in pieces so that js never holds a second full copy of
+// a model: begin_input(ctx, total size), then for every piece
+// append_input(ctx, piece size) and write the piece to the returned address,
+// finally end_input(ctx) returns the address to pass to an exporter. The
+// input is owned and freed by ctx.
+unsigned char *begin_input(WasmBuffer *ctx, const size_t size) {
+  return ctx->beginInput(size);
 }
 
-void free_exporter(WasmBuffer *ctx) {
-  if (ctx != NULL) {
-    ctx->freeBuffers();
-    free(ctx);
-    ctx = NULL;
-  }
+unsigned char *append_input(WasmBuffer *ctx, const size_t len) {
+  return ctx->appendInput(len);
 }
 
-unsigned char *get_buffer1(WasmBuffer *ctx) { return ctx->output_buffer1; }
+unsigned char *end_input(WasmBuffer *ctx) { return ctx->endInput(); }
 
-size_t get_buffer_size1(WasmBuffer *ctx) { return ctx->output_buffer_size1; }
+size_t result_count(WasmBuffer *ctx) { return ctx->resultCount(); }
 
-unsigned char *get_buffer2(WasmBuffer *ctx) { return ctx->output_buffer2; }
+unsigned char *result_ptr(WasmBuffer *ctx, const size_t i) {
+  const auto *res = ctx->result(i);
+  return res == nullptr ? nullptr : const_cast<unsigned char *>(res->data);
+}
 
-size_t get_buffer_size2(WasmBuffer *ctx) { return ctx->output_buffer_size2; }
+size_t result_size(WasmBuffer *ctx, const size_t i) {
+  const auto *res = ctx->result(i);
+  return res == nullptr ? 0 : res->size;
+}
 
-unsigned char *get_buffer3(WasmBuffer *ctx) { return ctx->output_buffer3; }
+int32_t result_kind(WasmBuffer *ctx, const size_t i) {
+  const auto *res = ctx->result(i);
+  return res == nullptr ? -1 : res->kind;
+}
 
-size_t get_buffer_size3(WasmBuffer *ctx) { return ctx->output_buffer_size3; }
+size_t read_output_chunk(WasmBuffer *ctx, const size_t i, const size_t offset,
+                         unsigned char *dst, const size_t len) {
+  return ctx->readResult(i, offset, dst, len);
+}
 
-// ------ onnx
+void release_output(WasmBuffer *ctx, const size_t i) {
+  ctx->releaseResult(i);
+}
 
-// for x in model.graph.initializer:
-//     input_names = [x.name for x in model.graph.input]
-//     if x.name not in input_names:
-//         shape = onnx.TensorShapeProto()
-//         for dim in x.dims:
-//             shape.dim.extend([onnx.TensorShapeProto.Dimension(dim_value=dim)])
-//         model.graph.input.extend(
-//             [onnx.ValueInfoProto(name=x.name,
-//                                  type=onnx.TypeProto(tensor_type=onnx.TypeProto.Tensor(elem_type=x.data_type,
-//                                                                                        shape=shape)))])
-// return model
-
-void add_initer_to_inputs(onnx::ModelProto &model) {
-  std::vector<std::string> input_names;
-  for (const auto &x : model.graph().input()) {
-    input_names.push_back(x.name());
-  }
-  for (const auto &x : model.graph().initializer()) {
-    if (std::find(input_names.begin(), input_names.end(), x.name()) ==
-        input_names.end()) {
-      auto *value_info = model.mutable_graph()->add_input();
-      value_info->set_name(x.name());
-      onnx::TypeProto *type = value_info->mutable_type();
-      auto *tensor = type->mutable_tensor_type();
-      tensor->set_elem_type(x.data_type());
-      auto *shape = tensor->mutable_shape();
-      for (const auto &dim : x.dims()) {
-        onnx::TensorShapeProto::Dimension *new_dim = shape->add_dim();
-        new_dim->set_dim_value(dim);
-      }
-    }
-  }
+static unsigned char *get_buffer(WasmBuffer *ctx, const int32_t kind) {
+  const auto *res = ctx->findResult(kind);
+  return res == nullptr ? nullptr : const_cast<unsigned char *>(res->data);
 }
 
+static size_t get_buffer_size(WasmBuffer *ctx, const int32_t kind) {
+  const auto *res = ctx->findResult(kind);
+  return res == nullptr ? 0 : res->size;
+}
+
+unsigned char *get_buffer1(WasmBuffer *ctx) {
+  return get_buffer(ctx, kResultModel);
+}
+
+size_t get_buffer_size1(WasmBuffer *ctx) {
+  return get_buffer_size(ctx, kResultModel);
+}
+
+unsigned char *get_buffer2(WasmBuffer *ctx) {
+  return get_buffer(ctx, kResultWeights);
+}
+
+size_t get_buffer_size2(WasmBuffer *ctx) {
+  return get_buffer_size(ctx, kResultWeights);
+}
+
+unsigned char *get_buffer3(WasmBuffer *ctx) {
+  return get_buffer(ctx, kResultMessage);
+}
+
+size_t get_buffer_size3(WasmBuffer *ctx) {
+  return get_buffer_size(ctx, kResultMessage);
+}
+
+// Keep conversions in a MemoryResultStore of capacity bytes, the result
+// cache is disabled by default and a capacity of 0 disables it again
+void result_cache_set_capacity(const size_t capacity) {
+  GlobalResultCache().SetStore(
+      capacity == 0 ? nullptr
+                    : std::unique_ptr<ResultStore>(
+                          new MemoryResultStore(capacity)));
+}
+
+#ifndef __EMSCRIPTEN__
+void result_cache_set_dir(const char *dir) {
+  GlobalResultCache().SetStore(
+      std::unique_ptr<ResultStore>(new DirectoryResultStore(dir)));
+}
+#endif
+
+void exporter_set_dedupe_initializers(WasmBuffer *ctx, const bool enable) {
+  ctx->options.dedupe_initializers = enable;
+}
+
+void exporter_set_verification(WasmBuffer *ctx, const int32_t policy,
+                               const int32_t runs, const double budget_ms) {
+  ctx->options.verify_policy = policy;
+  ctx->options.verify_runs = runs;
+  ctx->options.verify_budget_ms = budget_ms;
+}
+
+void exporter_set_tolerances(WasmBuffer *ctx, const double abs_tol,
+                             const double rel_tol, const double min_cosine,
+                             const uint32_t max_ulp) {
+  ctx->options.verify_abs_tol = abs_tol;
+  ctx->options.verify_rel_tol = rel_tol;
+  ctx->options.verify_min_cosine = min_cosine;
+  ctx->options.verify_max_ulp = max_ulp;
+}
+
+void exporter_set_log_level(const int32_t level) { SetLogLevel(level); }
+
+void result_cache_clear() { GlobalResultCache().Clear(); }
+
+size_t result_cache_hits() { return GlobalResultCache().hits(); }
+
+size_t result_cache_misses() { return GlobalResultCache().misses(); }
+
+// ------ onnx
+
 int check_static_input_size_export(WasmBuffer *ctx, unsigned char *buf,
                                    const size_t len) {
+  ExportTimer timer(ctx);
   try {
+    // only the graph interface is needed, initializer payloads are skipped
     onnx::ModelProto model;
-    bool s1 = model.ParseFromArray(buf, len);
+    timer.Begin("scan");
+    bool s1 = ScanModelInterface(buf, len, &model);
+    timer.End();
     if (!s1) {
       ctx->setBuffer3("parsing ONNX model fails");
       return -1;
     }
+    PhaseScope phase(&timer, "check");
+    const GraphIndex index(model.graph());
     for (const auto &x : model.graph().input()) {
-      for (const auto &initer : model.graph().initializer()) {
-        if (x.name() == initer.name()) {
-          continue;
-        }
+      // initializers listed as inputs have the static shape of the tensor
+      if (index.IsInitializer(x.name())) {
+        continue;
       }
       if (!CheckStaticInputShape(model, x.name())) {
         if (GetInputNames(model).size() > 1) {
@@ -184,98 +357,390 @@ int check_static_input_size_export(WasmBuffer *ctx, unsigned char *buf,
 bool onnxsimplify_export(WasmBuffer *ctx, unsigned char *buf, const size_t len,
                          const bool optimize, const int32_t *input_shape,
                          const size_t input_shape_len) {
+  ExportTimer timer(ctx);
   try {
+    std::string cache_key;
+    int32_t cached_ret;
+    timer.Begin("cache_lookup");
+    const bool cached = LookupConversion(
+        ctx, "onnxsim", buf, len,
+        OnnxSimOptions(ctx, optimize, input_shape, input_shape_len),
+        &cache_key, &cached_ret);
+    timer.End();
+    if (cached) {
+      if (!ctx->releaseInput(buf)) {
+        free(buf);
+      }
+      return cached_ret;
+    }
     onnx::ModelProto opt_model;
-    bool check;
     {
-      onnx::ModelProto model;
+      // The original model is only needed until Check, so it lives in an
+      // arena which is dropped in one go at the end of this scope.
+      // opt_model is returned by value from Simplify and can not be put
+      // on the arena without a copy.
+      timer.Begin("parse");
+      google::protobuf::Arena arena(ModelArenaOptions(len));
+      auto &model =
+          *google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
       bool s1 = model.ParseFromArray(buf, len);
-      free(buf);
+      // the model is owned by us either way
+      if (!ctx->releaseInput(buf)) {
+        free(buf);
+      }
+      timer.End();
       if (!s1) {
         ctx->setBuffer3("parsing ONNX model fails");
         return false;
       }
-      add_initer_to_inputs(model);
-      MyTensorShapeMap input_map;
-      const std::string input_name = GetInputNames(model)[0];
-      if (input_shape_len > 0) {
-        MyTensorShape shape;
-        FOR(i, input_shape_len) { shape.push_back(input_shape[i]); }
-        for (const auto &x : shape) {
-          std::cout << __LINE__ << " " << x << std::endl;
-        }
-        input_map[input_name] = shape;
+      opt_model = SimplifyAndCheck(ctx, &timer, model, optimize, input_shape,
+                                   input_shape_len, &cache_key);
+    }
+    timer.Begin("serialize");
+    auto byte_size = opt_model.ByteSizeLong();
+    void *buf = malloc(byte_size);
+    bool s2 = opt_model.SerializeToArray(buf, byte_size);
+    timer.End();
+    if (!s2) {
+      free(buf);
+      ctx->setBuffer3("serialing ONNX model fails");
+      return false;
+    }
+    PhaseScope phase(&timer, "output");
+    ctx->setBuffer1(buf, byte_size);
+    CacheConversion(ctx, cache_key, true);
+    return true;
+  } catch (std::exception &e) {
+    ctx->setBuffer3(e.what());
+    return false;
+  }
+}
+
+// The dedupe pass and output of onnx_dedupe_export and onnx_dedupe_file
+// on a parsed model
+static bool DedupeModel(WasmBuffer *ctx, ExportTimer *timer,
+                        onnx::ModelProto &model) {
+  std::string str;
+  timer->Begin("dedupe");
+  ctx->setResult(kResultStats, DedupeStatsJson(DedupeInitializers(model)));
+  timer->End();
+  {
+    PhaseScope phase(timer, "serialize");
+    if (!model.SerializeToString(&str)) {
+      ctx->setBuffer3("serialing ONNX model fails");
+      return false;
+    }
+  }
+  PhaseScope phase(timer, "output");
+  ctx->setBuffer1(std::move(str));
+  return true;
+}
+
+bool onnx_dedupe_export(WasmBuffer *ctx, unsigned char *buf,
+                        const size_t len) {
+  ExportTimer timer(ctx);
+  try {
+    timer.Begin("parse");
+    google::protobuf::Arena arena(ModelArenaOptions(len));
+    auto &model =
+        *google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
+    bool s1 = model.ParseFromArray(buf, len);
+    if (!ctx->releaseInput(buf)) {
+      free(buf);
+    }
+    timer.End();
+    if (!s1) {
+      ctx->setBuffer3("parsing ONNX model fails");
+      return false;
+    }
+    return DedupeModel(ctx, &timer, model);
+  } catch (std::exception &e) {
+    ctx->setBuffer3(e.what());
+    return false;
+  }
+}
+
+#ifndef __EMSCRIPTEN__
+static bool WriteFile(const char *path, const void *data, const size_t len) {
+  std::ofstream ofs(path, std::ios::out | std::ios::binary);
+  ofs.write(static_cast<const char *>(data), len);
+  return static_cast<bool>(ofs);
+}
+
+bool onnx_dedupe_file(WasmBuffer *ctx, const char *input_path) {
+  ExportTimer timer(ctx);
+  try {
+    MappedFile file;
+    if (!file.Open(input_path)) {
+      ctx->setBuffer3(std::string("cannot open ") + input_path);
+      return false;
+    }
+    timer.Begin("parse");
+    google::protobuf::Arena arena(ModelArenaOptions(file.size()));
+    auto &model =
+        *google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
+    bool s1 = model.ParseFromArray(file.data(), file.size());
+    file.Close();
+    timer.End();
+    if (!s1) {
+      ctx->setBuffer3("parsing ONNX model fails");
+      return false;
+    }
+    return DedupeModel(ctx, &timer, model);
+  } catch (std::exception &e) {
+    ctx->setBuffer3(e.what());
+    return false;
+  }
+}
+
+bool onnxsimplify_file(WasmBuffer *ctx, const char *input_path,
+                       const char *output_path, const bool optimize,
+                       const int32_t *input_shape,
+                       const size_t input_shape_len,
+                       const bool external_data) {
+  ExportTimer timer(ctx);
+  try {
+    onnx::ModelProto opt_model;
+    bool has_external_data;
+    std::string cache_key;
+    {
+      MappedFile file;
+      if (!file.Open(input_path)) {
+        ctx->setBuffer3(std::string("cannot open ") + input_path);
+        return false;
       }
-      std::cout << __LINE__ << " " << input_map.size() << std::endl;
-      if (input_map.size() > 0) {
-        std::cout << __LINE__ << " " << input_map[input_name].size()
-                  << std::endl;
-        for (const auto &x : input_map[input_name]) {
-          std::cout << __LINE__ << " " << x << std::endl;
+      // The key only hashes the .onnx, not the side files of an input
+      // with external data, which is only known after parsing. Such
+      // outputs are never inserted (see cache_key.clear() below), and the
+      // target is not the "onnxsim" of onnxsimplify_export, which may
+      // cache the same bytes without their side files in the same store.
+      int32_t cached_ret;
+      timer.Begin("cache_lookup");
+      const bool cached =
+          !external_data &&
+          LookupConversion(ctx, "onnxsim_file", file.data(), file.size(),
+                           OnnxSimOptions(ctx, optimize, input_shape,
+                                          input_shape_len),
+                           &cache_key, &cached_ret);
+      timer.End();
+      if (cached) {
+        PhaseScope phase(&timer, "output");
+        const auto *res = ctx->findResult(kResultModel);
+        if (!WriteFile(output_path, res->data, res->size)) {
+          ctx->setBuffer3(std::string("cannot write ") + output_path);
+          return false;
         }
+        return cached_ret;
+      }
+      timer.Begin("parse");
+      google::protobuf::Arena arena(ModelArenaOptions(file.size()));
+      auto &model =
+          *google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
+      bool s1 = model.ParseFromArray(file.data(), file.size());
+      file.Close();
+      timer.End();
+      if (!s1) {
+        ctx->setBuffer3("parsing ONNX model fails");
+        return false;
+      }
+      timer.Begin("load_external_data");
+      std::string error;
+      const std::string path = input_path;
+      const auto pos = path.find_last_of('/');
+      const int loaded = LoadExternalData(
+          &model, pos == std::string::npos ? "." : path.substr(0, pos),
+          &error);
+      timer.End();
+      if (loaded < 0) {
+        ctx->setBuffer3(error);
+        return false;
+      }
+      has_external_data = loaded > 0;
+      opt_model = SimplifyAndCheck(ctx, &timer, model, optimize, input_shape,
+                                   input_shape_len, &cache_key);
+    }
+    // serializing and writing the output
+    timer.Begin("serialize");
+    // protobuf can not serialize a message over 2 GB
+    const size_t kExternalDataThreshold = 1024;
+    if (external_data || has_external_data ||
+        opt_model.ByteSizeLong() > static_cast<size_t>(INT_MAX)) {
+      std::string error;
+      if (!SaveWithExternalData(&opt_model, output_path,
+                                kExternalDataThreshold, &error)) {
+        ctx->setBuffer3(error);
+        return false;
+      }
+      // the output is not in memory to be cached
+      cache_key.clear();
+    } else if (!cache_key.empty()) {
+      // the cache needs the output in memory anyway
+      std::string str;
+      if (!opt_model.SerializeToString(&str)) {
+        ctx->setBuffer3("serialing ONNX model fails");
+        return false;
+      }
+      if (!WriteFile(output_path, str.data(), str.size())) {
+        ctx->setBuffer3(std::string("cannot write ") + output_path);
+        return false;
+      }
+      ctx->setBuffer1(std::move(str));
+    } else {
+      std::ofstream ofs(output_path, std::ios::out | std::ios::binary);
+      if (!opt_model.SerializeToOstream(&ofs)) {
+        ctx->setBuffer3("serialing ONNX model fails");
+        return false;
       }
+    }
+    timer.End();
+    PhaseScope phase(&timer, "output");
+    CacheConversion(ctx, cache_key, true);
+    return true;
+  } catch (std::exception &e) {
+    ctx->setBuffer3(e.what());
+    return false;
+  }
+}
+#endif
 
-      std::cout << "simplify begin" << std::endl;
-      opt_model = Simplify(model, optimize, input_map);
-      std::cout << "simplify end" << std::endl;
-      try {
-        check = Check(opt_model, model, input_map);
-      } catch (const std::exception &e) {
-        std::cout << "check exception: " << e.what() << std::endl;
-        check = false;
+#ifdef WMC_NCNN_PIPELINE
+bool onnx2ncnn_export(WasmBuffer *ctx, unsigned char *buf, const size_t len,
+                      const bool simplify, const bool optimize,
+                      const bool fp16) {
+  ExportTimer timer(ctx);
+  try {
+    std::string options = std::string(simplify ? "sim=1;" : "sim=0;") +
+                          (optimize ? "ncnnopt=1;" : "ncnnopt=0;") +
+                          (fp16 ? "fp16=1;" : "fp16=0;");
+    if (simplify) {
+      options += OnnxSimOptions(ctx, true, nullptr, 0);
+    }
+    std::string cache_key;
+    int32_t cached_ret;
+    timer.Begin("cache_lookup");
+    const bool cached = LookupConversion(ctx, "onnx2ncnn", buf, len, options,
+                                         &cache_key, &cached_ret);
+    timer.End();
+    if (cached) {
+      if (!ctx->releaseInput(buf)) {
+        free(buf);
       }
-      std::cout << "check end" << std::endl;
-      if (check) {
-        std::cout << "check ok" << std::endl;
-      } else {
-        std::cout << "check failed" << std::endl;
+      return cached_ret;
+    }
+    // The one parse of the model. onnx2ncnn takes it over by Swap, which
+    // copies a message on an arena, so only the original model of the
+    // simplifier lives on one.
+    onnx::ModelProto model;
+    if (simplify) {
+      timer.Begin("parse");
+      google::protobuf::Arena arena(ModelArenaOptions(len));
+      auto &orig_model =
+          *google::protobuf::Arena::CreateMessage<onnx::ModelProto>(&arena);
+      bool s1 = orig_model.ParseFromArray(buf, len);
+      if (!ctx->releaseInput(buf)) {
+        free(buf);
+      }
+      timer.End();
+      if (!s1) {
+        ctx->setBuffer3("parsing ONNX model fails");
+        return false;
+      }
+      model = SimplifyAndCheck(ctx, &timer, orig_model, true, nullptr, 0,
+                               &cache_key);
+      // The verification is reported in kResultVerification and the log.
+      // kResultMessage is what onnx2ncnn has to say, as on the page before.
+      ctx->freeResult(kResultMessage);
+    } else {
+      timer.Begin("parse");
+      bool s1 = model.ParseFromArray(buf, len);
+      if (!ctx->releaseInput(buf)) {
+        free(buf);
+      }
+      timer.End();
+      if (!s1) {
+        ctx->setBuffer3("parsing ONNX model fails");
+        return false;
       }
     }
-    auto byte_size = opt_model.ByteSizeLong();
-    void *buf = malloc(byte_size);
-    bool s2 = opt_model.SerializeToArray(buf, byte_size);
+    std::string param;
+    std::string bin;
+    std::string messages;
+    timer.Begin("onnx2ncnn");
+    const bool s2 = OnnxToNcnn(&model, &param, &bin, &messages);
+    timer.End();
     if (!s2) {
-      ctx->setBuffer3("serialing ONNX model fails");
+      WMC_ERROR("onnx2ncnn: %s", messages.c_str());
+      ctx->setBuffer3(messages.empty() ? "onnx2ncnn fails"
+                                       : std::move(messages));
       return false;
     }
-    ctx->setBuffer1(buf, byte_size);
-    if (!check) {
-      ctx->setBuffer3(
-          "The result is different after simplifying, sometimes it is "
-          "something wrong in onnx simplifier, but sometimes it is just "
-          "numerical error, please be careful to use the simplified model.");
+    // an incomplete conversion, e.g. with unsupported operators, is not
+    // optimized, like by the separate tools
+    if (optimize && messages.empty()) {
+      timer.Begin("ncnnoptimize");
+      const bool s3 = OptimizeNcnn(&param, &bin, fp16);
+      timer.End();
+      if (!s3) {
+        ctx->setBuffer3("ncnnoptimize fails");
+        return false;
+      }
+    }
+    PhaseScope phase(&timer, "output");
+    ctx->setResult(kResultModel, std::move(param));
+    ctx->setResult(kResultWeights, std::move(bin));
+    if (!messages.empty()) {
+      ctx->setBuffer3(std::move(messages));
     }
+    CacheConversion(ctx, cache_key, true);
     return true;
   } catch (std::exception &e) {
     ctx->setBuffer3(e.what());
     return false;
   }
 }
+#endif
 
 bool onnx2tnn_export(WasmBuffer *ctx, void *buffer, const size_t bufferlen) {
-  std::cout << bufferlen << std::endl;
-  std::cout << __LINE__ << std::endl;
+  ExportTimer timer(ctx);
+  WMC_DEBUG("onnx2tnn: %zu bytes", bufferlen);
+  std::string cache_key;
+  int32_t cached_ret;
+  timer.Begin("cache_lookup");
+  const bool cached = LookupConversion(ctx, "onnx2tnn", buffer, bufferlen, "",
+                                       &cache_key, &cached_ret);
+  timer.End();
+  if (cached) {
+    return cached_ret;
+  }
+  void *input = buffer;
+  // parse and convert, inside of the converter
+  timer.Begin("convert");
   Onnx2TNN converter(&buffer, bufferlen);
-  const auto expected_res = converter.Convert();
-  std::cout << __LINE__ << std::endl;
+  auto expected_res = converter.Convert();
+  timer.End();
+  if (buffer != input) {
+    // the converter has taken the input over
+    ctx->detachInput(input);
+  }
   if (!expected_res) {
-    std::cout << expected_res.error() << std::endl;
+    WMC_ERROR("onnx2tnn: %s", expected_res.error().c_str());
     ctx->setBuffer3(expected_res.error());
     return false;
   }
-  std::cout << __LINE__ << std::endl;
-  const auto res = expected_res.value();
-  std::cout << __LINE__ << std::endl;
-  const auto pv = std::get<0>(res);
-  const auto str_file_model = std::get<1>(res);
-  size_t model_size = str_file_model.size();
-  void* ptr_data = (void*) str_file_model.data();
-  auto bv = std::make_pair(ptr_data, model_size);
-  const auto error_msg = std::get<2>(res);
-  PNT(pv.second, bv.second, error_msg);
-  ctx->setBuffer1(pv);
-  ctx->setBuffer2(bv);
-  ctx->setBuffer3(error_msg);
+  // The .tnnmodel bytes live in the string produced by Convert(), which is
+  // the only copy of the weights. Move it into ctx so that it lives until
+  // free_exporter instead of dying with this frame.
+  auto &res = *expected_res;
+  const Buffer pv = std::get<0>(res);
+  std::string &str_file_model = std::get<1>(res);
+  std::string &error_msg = std::get<2>(res);
+  WMC_DEBUG("onnx2tnn: %zu bytes of tnnproto, %zu bytes of tnnmodel, %s",
+            pv.second, str_file_model.size(), error_msg.c_str());
+  PhaseScope phase(&timer, "output");
+  ctx->setResult(kResultModel, pv);
+  ctx->setResult(kResultWeights, std::move(str_file_model));
+  ctx->setBuffer3(std::move(error_msg));
+  CacheConversion(ctx, cache_key, true);
 
   return true;
 }
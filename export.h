@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/wasm_buffer.h"
+
+// The api of the exporter. It is exported to js by emscripten (see
+// EXPORTED_FUNCTIONS in CMakeLists.txt) and linked into wmc-export in the
+// native build. Every exporter takes a ctx from create_exporter, which owns
+// the inputs and outputs of the conversion until free_exporter.
+extern "C" {
+
+WasmBuffer *create_exporter();
+void free_exporter(WasmBuffer *ctx);
+
+unsigned char *begin_input(WasmBuffer *ctx, size_t size);
+unsigned char *append_input(WasmBuffer *ctx, size_t len);
+unsigned char *end_input(WasmBuffer *ctx);
+
+size_t result_count(WasmBuffer *ctx);
+unsigned char *result_ptr(WasmBuffer *ctx, size_t i);
+size_t result_size(WasmBuffer *ctx, size_t i);
+int32_t result_kind(WasmBuffer *ctx, size_t i);
+size_t read_output_chunk(WasmBuffer *ctx, size_t i, size_t offset,
+                         unsigned char *dst, size_t len);
+void release_output(WasmBuffer *ctx, size_t i);
+
+unsigned char *get_buffer1(WasmBuffer *ctx);
+size_t get_buffer_size1(WasmBuffer *ctx);
+unsigned char *get_buffer2(WasmBuffer *ctx);
+size_t get_buffer_size2(WasmBuffer *ctx);
+unsigned char *get_buffer3(WasmBuffer *ctx);
+size_t get_buffer_size3(WasmBuffer *ctx);
+
+// Options of the exporters run on ctx afterwards
+// dedupe identical initializers before onnxsimplify, see onnx_passes.h
+void exporter_set_dedupe_initializers(WasmBuffer *ctx, bool enable);
+// how onnxsimplify verifies its output (a VerifyPolicy), the number of
+// runs on random inputs and a wall-clock budget for them in ms (0 for no
+// limit, only for kVerifySampled). The default is kVerifyFull with one run.
+void exporter_set_verification(WasmBuffer *ctx, int32_t policy, int32_t runs,
+                               double budget_ms);
+// when the outputs of the simplified model count as equal to the original
+// ones, see Tolerances in tensor_compare.h
+void exporter_set_tolerances(WasmBuffer *ctx, double abs_tol, double rel_tol,
+                             double min_cosine, uint32_t max_ulp);
+// the least LogLevel (see log.h) of the entries in kResultLog, for every ctx
+void exporter_set_log_level(int32_t level);
+
+// Conversions are cached by the hash of their input and options, see
+// result_cache.h. The cache is off unless one of these sets a store, the
+// native tools use result_cache_set_dir (--cache-dir).
+void result_cache_set_capacity(size_t capacity);
+void result_cache_clear();
+size_t result_cache_hits();
+size_t result_cache_misses();
+
+// 2: all inputs have static shapes, 1: the only input has a dynamic shape,
+// -2: one of multiple inputs has a dynamic shape, -1: error
+int check_static_input_size_export(WasmBuffer *ctx, unsigned char *buf,
+                                   size_t len);
+// buf is owned by the exporter after the call
+bool onnxsimplify_export(WasmBuffer *ctx, unsigned char *buf, size_t len,
+                         bool optimize, const int32_t *input_shape,
+                         size_t input_shape_len);
+bool onnx2tnn_export(WasmBuffer *ctx, void *buffer, size_t bufferlen);
+// only the initializer dedupe pass, buf is owned by the exporter after the
+// call. The model is a kResultModel output, the stats a kResultStats one.
+bool onnx_dedupe_export(WasmBuffer *ctx, unsigned char *buf, size_t len);
+
+#ifdef WMC_NCNN_PIPELINE
+// onnxsimplify (if simplify), onnx2ncnn and ncnnoptimize (if optimize) on
+// one parsed model, without files in between, see ncnn_pipeline.h. buf is
+// owned by the exporter after the call. The ncnn param and bin are the
+// kResultModel and kResultWeights outputs, what onnx2ncnn printed (e.g.
+// unsupported operators) is a kResultMessage one and skips ncnnoptimize.
+bool onnx2ncnn_export(WasmBuffer *ctx, unsigned char *buf, size_t len,
+                      bool simplify, bool optimize, bool fp16);
+#endif
+
+#ifndef __EMSCRIPTEN__
+// onnxsimplify_export from file to file. The model is read through a memory
+// mapping and may use ONNX external data, which is resolved next to it.
+// The output is written with external data (output_path + ".data") if
+// external_data is set, if the input had external data, or if it is over
+// the 2 GB protobuf limit.
+bool onnxsimplify_file(WasmBuffer *ctx, const char *input_path,
+                       const char *output_path, bool optimize,
+                       const int32_t *input_shape, size_t input_shape_len,
+                       bool external_data);
+// onnx_dedupe_export of a model read through a memory mapping
+bool onnx_dedupe_file(WasmBuffer *ctx, const char *input_path);
+// cache conversions in files under dir instead of in memory
+void result_cache_set_dir(const char *dir);
+#endif
+}
@@ -0,0 +1,160 @@
+#include "external_data.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+
+#include "mapped_file.h"
+
+namespace {
+
+// side files are aligned so that they can be mapped tensor by tensor
+const size_t kExternalDataAlignment = 4096;
+
+template <typename F>
+void ForEachTensor(onnx::GraphProto *graph, F &&func) {
+  for (auto &tensor : *graph->mutable_initializer()) {
+    func(&tensor);
+  }
+  for (auto &node : *graph->mutable_node()) {
+    for (auto &attr : *node.mutable_attribute()) {
+      if (attr.has_t()) {
+        func(attr.mutable_t());
+      }
+      for (auto &tensor : *attr.mutable_tensors()) {
+        func(&tensor);
+      }
+      if (attr.has_g()) {
+        ForEachTensor(attr.mutable_g(), func);
+      }
+      for (auto &subgraph : *attr.mutable_graphs()) {
+        ForEachTensor(&subgraph, func);
+      }
+    }
+  }
+}
+
+std::string BaseName(const std::string &path) {
+  const auto pos = path.find_last_of('/');
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+// free the bytes of raw_data, clear_raw_data keeps the capacity
+void ReleaseRawData(onnx::TensorProto *tensor) {
+  std::string().swap(*tensor->mutable_raw_data());
+  tensor->clear_raw_data();
+}
+
+}  // namespace
+
+int LoadExternalData(onnx::ModelProto *model, const std::string &base_dir,
+                     std::string *error) {
+  std::map<std::string, std::unique_ptr<MappedFile>> files;
+  int loaded = 0;
+  bool ok = true;
+  ForEachTensor(model->mutable_graph(), [&](onnx::TensorProto *tensor) {
+    if (!ok || tensor->data_location() != onnx::TensorProto::EXTERNAL) {
+      return;
+    }
+    std::string location;
+    size_t offset = 0;
+    size_t length = 0;
+    bool has_length = false;
+    for (const auto &entry : tensor->external_data()) {
+      if (entry.key() == "location") {
+        location = entry.value();
+      } else if (entry.key() == "offset") {
+        offset = strtoull(entry.value().c_str(), nullptr, 10);
+      } else if (entry.key() == "length") {
+        length = strtoull(entry.value().c_str(), nullptr, 10);
+        has_length = true;
+      }
+    }
+    // like onnx.checker, side files must stay inside the model directory
+    if (location.empty() || location[0] == '/' ||
+        location.find("..") != std::string::npos) {
+      *error = "invalid external data location \"" + location +
+               "\" of tensor " + tensor->name();
+      ok = false;
+      return;
+    }
+    auto &file = files[location];
+    if (!file) {
+      file.reset(new MappedFile());
+      if (!file->Open(base_dir + "/" + location)) {
+        *error = "cannot open external data file " + location;
+        ok = false;
+        return;
+      }
+    }
+    if (!has_length && offset <= file->size()) {
+      length = file->size() - offset;
+    }
+    if (offset > file->size() || length > file->size() - offset) {
+      *error = "external data of tensor " + tensor->name() +
+               " is out of the range of " + location;
+      ok = false;
+      return;
+    }
+    tensor->set_raw_data(file->data() + offset, length);
+    file->Evict(offset, length);
+    tensor->clear_external_data();
+    tensor->clear_data_location();
+    loaded++;
+  });
+  return ok ? loaded : -1;
+}
+
+bool SaveWithExternalData(onnx::ModelProto *model,
+                          const std::string &model_path,
+                          const size_t threshold, std::string *error) {
+  const std::string data_path = model_path + ".data";
+  const std::string location = BaseName(data_path);
+  FILE *fp = fopen(data_path.c_str(), "wb");
+  if (fp == nullptr) {
+    *error = "cannot open " + data_path;
+    return false;
+  }
+  size_t offset = 0;
+  bool ok = true;
+  static const char kZeros[kExternalDataAlignment] = {};
+  for (auto &tensor : *model->mutable_graph()->mutable_initializer()) {
+    const auto &raw = tensor.raw_data();
+    if (!tensor.has_raw_data() || raw.size() < threshold) {
+      continue;
+    }
+    const size_t padding =
+        (kExternalDataAlignment - offset % kExternalDataAlignment) %
+        kExternalDataAlignment;
+    if (fwrite(kZeros, 1, padding, fp) != padding ||
+        fwrite(raw.data(), 1, raw.size(), fp) != raw.size()) {
+      ok = false;
+      break;
+    }
+    offset += padding;
+    const auto add_entry = [&tensor](const std::string &key,
+                                     const std::string &value) {
+      auto *entry = tensor.add_external_data();
+      entry->set_key(key);
+      entry->set_value(value);
+    };
+    add_entry("location", location);
+    add_entry("offset", std::to_string(offset));
+    add_entry("length", std::to_string(raw.size()));
+    offset += raw.size();
+    tensor.set_data_location(onnx::TensorProto::EXTERNAL);
+    ReleaseRawData(&tensor);
+  }
+  if (fclose(fp) != 0 || !ok) {
+    *error = "cannot write " + data_path;
+    return false;
+  }
+  std::ofstream ofs(model_path, std::ios::out | std::ios::binary);
+  if (!model->SerializeToOstream(&ofs)) {
+    *error = "cannot write " + model_path;
+    return false;
+  }
+  return true;
+}
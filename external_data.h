@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// ONNX external data: tensors whose bytes are stored in side files next to
+// the model instead of in raw_data, which is required for models over the
+// 2 GB protobuf limit. Native builds only.
+
+// Load every tensor of the model (initializers and tensor attributes, in
+// subgraphs too) that has data_location EXTERNAL into raw_data. The side
+// files are resolved relative to base_dir and read through memory mappings,
+// whose pages are dropped as soon as each tensor is copied.
+// The tensors are copies, not views: raw_data is a std::string, which
+// cannot alias the mapping, and Simplify reads every initializer anyway. So
+// the mappings only save the read buffers, the heap holds the whole model
+// plus what Simplify makes of it, not just the working set.
+// Returns the number of tensors loaded, or -1 and sets error.
+int LoadExternalData(onnx::ModelProto *model, const std::string &base_dir,
+                     std::string *error);
+
+// Write the model to model_path with the raw_data of every initializer of
+// at least `threshold` bytes moved into model_path + ".data". Tensors are
+// written and freed one by one, so the serialized model is never held in
+// memory. Returns false and sets error on failure.
+bool SaveWithExternalData(onnx::ModelProto *model,
+                          const std::string &model_path, size_t threshold,
+                          std::string *error);
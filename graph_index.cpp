@@ -0,0 +1,56 @@
+#include "graph_index.h"
+
+GraphIndex::GraphIndex(const onnx::GraphProto &graph) {
+  entries_.reserve(graph.input_size() + graph.initializer_size() +
+                   graph.value_info_size() + graph.node_size());
+  for (int i = 0; i < graph.input_size(); i++) {
+    auto &entry = Get(graph.input(i).name());
+    if (entry.input == -1) {
+      entry.input = i;
+    }
+  }
+  for (int i = 0; i < graph.initializer_size(); i++) {
+    auto &entry = Get(graph.initializer(i).name());
+    if (entry.initializer == -1) {
+      entry.initializer = i;
+    }
+  }
+  for (int i = 0; i < graph.value_info_size(); i++) {
+    auto &entry = Get(graph.value_info(i).name());
+    if (entry.value_info == -1) {
+      entry.value_info = i;
+    }
+  }
+  for (int i = 0; i < graph.output_size(); i++) {
+    auto &entry = Get(graph.output(i).name());
+    if (entry.output == -1) {
+      entry.output = i;
+    }
+  }
+  for (int i = 0; i < graph.node_size(); i++) {
+    const auto &node = graph.node(i);
+    for (const auto &name : node.input()) {
+      // an empty name is an omitted optional input
+      if (!name.empty()) {
+        Get(name).consumers.push_back(i);
+      }
+    }
+    for (const auto &name : node.output()) {
+      if (!name.empty()) {
+        Get(name).producer = i;
+      }
+    }
+  }
+}
+
+const GraphIndex::Entry *GraphIndex::Find(const std::string &name) const {
+  const auto it = entries_.find(&name);
+  return it == entries_.end() ? nullptr : &it->second;
+}
+
+void GraphIndex::AddInput(const onnx::GraphProto &graph, const int i) {
+  auto &entry = Get(graph.input(i).name());
+  if (entry.input == -1) {
+    entry.input = i;
+  }
+}
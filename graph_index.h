@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// Name lookups over a GraphProto, built once in O(size of graph) so that
+// passes do not have to compare every name with every other name.
+//
+// The keys point at the name strings inside the graph instead of copying
+// them, so the index is valid as long as the indexed names are neither
+// changed nor removed. Appending to the graph is fine, but is not reflected
+// in the index unless recorded by the Add* methods.
+class GraphIndex {
+ public:
+  struct Entry {
+    // positions in graph.input, graph.initializer, ..., -1 if absent
+    int input = -1;
+    int initializer = -1;
+    int value_info = -1;
+    int output = -1;
+    // the node that produces this value, -1 for graph inputs/initializers
+    int producer = -1;
+    // the nodes that take this value as input, in graph order
+    std::vector<int> consumers;
+  };
+
+  explicit GraphIndex(const onnx::GraphProto &graph);
+
+  // nullptr if no input, initializer, value_info, output or node of the
+  // graph has this name
+  const Entry *Find(const std::string &name) const;
+
+  bool IsInput(const std::string &name) const {
+    const auto *entry = Find(name);
+    return entry != nullptr && entry->input != -1;
+  }
+  bool IsInitializer(const std::string &name) const {
+    const auto *entry = Find(name);
+    return entry != nullptr && entry->initializer != -1;
+  }
+
+  // record graph.input(i) after a pass appends it
+  void AddInput(const onnx::GraphProto &graph, int i);
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct NameHash {
+    size_t operator()(const std::string *name) const {
+      return std::hash<std::string>()(*name);
+    }
+  };
+  struct NameEqual {
+    bool operator()(const std::string *a, const std::string *b) const {
+      return *a == *b;
+    }
+  };
+
+  Entry &Get(const std::string &name) { return entries_[&name]; }
+
+  std::unordered_map<const std::string *, Entry, NameHash, NameEqual>
+      entries_;
+};
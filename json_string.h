@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// str as a quoted json string
+inline std::string JsonString(const std::string &str) {
+  std::string res = "\"";
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      res += '\\';
+      res += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      res += buf;
+    } else {
+      res += c;
+    }
+  }
+  return res + "\"";
+}
@@ -0,0 +1,124 @@
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+// A longer message is truncated, no entry allocates
+constexpr size_t kEntrySize = 256;
+constexpr size_t kEntryCount = 256;
+
+const char *const kLevelNames[] = {"D", "I", "W", "E"};
+
+struct LogRing {
+  std::mutex mutex;
+  char entries[kEntryCount][kEntrySize];
+  size_t lens[kEntryCount];
+  // index of the oldest entry and the number of entries
+  size_t head = 0;
+  size_t count = 0;
+  size_t dropped = 0;
+  // read by LogEnabled without the lock
+  std::atomic<int32_t> level{kLogInfo};
+  LogSink sink = nullptr;
+  void *user = nullptr;
+};
+
+LogRing &Ring() {
+  static LogRing ring;
+  return ring;
+}
+
+void StderrSink(const char *batch, const size_t len, void *) {
+  fwrite(batch, 1, len, stderr);
+  fflush(stderr);
+}
+
+// Only called with the lock held
+void FlushLocked(LogRing &ring) {
+  if (ring.count == 0 && ring.dropped == 0) {
+    return;
+  }
+  // one contiguous batch for the sink, its size is bounded by the ring
+  static char batch[kEntryCount * kEntrySize + 64];
+  size_t len = 0;
+  if (ring.dropped > 0) {
+    len += snprintf(batch, 64, "W (%zu log entries dropped)\n", ring.dropped);
+    ring.dropped = 0;
+  }
+  for (size_t i = 0; i < ring.count; i++) {
+    const size_t j = (ring.head + i) % kEntryCount;
+    memcpy(batch + len, ring.entries[j], ring.lens[j]);
+    len += ring.lens[j];
+  }
+  ring.head = 0;
+  ring.count = 0;
+  (ring.sink == nullptr ? StderrSink : ring.sink)(batch, len, ring.user);
+}
+
+}  // namespace
+
+void SetLogSink(LogSink sink, void *user, LogSink *prev, void **prev_user) {
+  auto &ring = Ring();
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  // the buffered entries belong to the old sink
+  FlushLocked(ring);
+  if (prev != nullptr) {
+    *prev = ring.sink;
+  }
+  if (prev_user != nullptr) {
+    *prev_user = ring.user;
+  }
+  ring.sink = sink;
+  ring.user = user;
+}
+
+void SetLogLevel(const int32_t level) {
+  Ring().level.store(level, std::memory_order_relaxed);
+}
+
+bool LogEnabled(const int32_t level) {
+  // relaxed, a racing SetLogLevel only decides a message or two
+  return level >= Ring().level.load(std::memory_order_relaxed);
+}
+
+void LogMessage(const int32_t level, const char *fmt, ...) {
+  auto &ring = Ring();
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  size_t j;
+  if (ring.count == kEntryCount) {
+    j = ring.head;
+    ring.head = (ring.head + 1) % kEntryCount;
+    ring.dropped++;
+  } else {
+    j = (ring.head + ring.count) % kEntryCount;
+    ring.count++;
+  }
+  char *entry = ring.entries[j];
+  const int l = level < kLogDebug || level > kLogError ? kLogError : level;
+  int len = snprintf(entry, kEntrySize, "%s ", kLevelNames[l]);
+  va_list args;
+  va_start(args, fmt);
+  const int n = vsnprintf(entry + len, kEntrySize - len, fmt, args);
+  va_end(args);
+  // truncated to the entry, with room for the newline
+  len = n < 0 ? len : std::min<int>(len + n, kEntrySize - 2);
+  entry[len++] = '\n';
+  entry[len] = '\0';
+  ring.lens[j] = len;
+  // errors are not held back, the conversion may be about to abort
+  if (level >= kLogError) {
+    FlushLocked(ring);
+  }
+}
+
+void FlushLog() {
+  auto &ring = Ring();
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  FlushLocked(ring);
+}
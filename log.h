@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The log of the exporter core. Entries go to a fixed ring buffer and are
+// delivered to the sink in batches, once per top-level phase of a
+// conversion (see PhaseTimer) or on FlushLog, instead of one write per
+// line. When the ring is full, the oldest entries are dropped.
+
+// Part of the js api (exporter_set_log_level), only append to it
+enum LogLevel : int32_t {
+  kLogDebug = 0,
+  kLogInfo = 1,
+  kLogWarning = 2,
+  kLogError = 3,
+};
+
+// Gets the entries of a batch, each of them ends with '\n'
+using LogSink = void (*)(const char *batch, size_t len, void *user);
+
+// The default sink writes to stderr. Returns the previous sink and its
+// user data in `prev` and `prev_user`, if not nullptr.
+void SetLogSink(LogSink sink, void *user, LogSink *prev = nullptr,
+                void **prev_user = nullptr);
+// entries below `level` are dropped at the call, kLogInfo by default
+void SetLogLevel(int32_t level);
+bool LogEnabled(int32_t level);
+void LogMessage(int32_t level, const char *fmt, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+// deliver the buffered entries to the sink in one call
+void FlushLog();
+
+#define WMC_LOG(level, ...)            \
+  do {                                 \
+    if (LogEnabled(level)) {           \
+      LogMessage(level, __VA_ARGS__);  \
+    }                                  \
+  } while (0)
+
+#define WMC_INFO(...) WMC_LOG(kLogInfo, __VA_ARGS__)
+#define WMC_WARN(...) WMC_LOG(kLogWarning, __VA_ARGS__)
+#define WMC_ERROR(...) WMC_LOG(kLogError, __VA_ARGS__)
+// compiled out of release builds (NDEBUG) and of the wasm build
+// (WMC_NO_DEBUG_LOG, see CMakeLists.txt), arguments are not evaluated
+#if defined(NDEBUG) || defined(WMC_NO_DEBUG_LOG)
+#define WMC_DEBUG(...) \
+  do {                 \
+  } while (0)
+#else
+#define WMC_DEBUG(...) WMC_LOG(kLogDebug, __VA_ARGS__)
+#endif
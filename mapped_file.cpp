@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::Open(const std::string &path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      size_ = 0;
+      close(fd);
+      return false;
+    }
+    data_ = static_cast<unsigned char *>(addr);
+    // models are parsed and copied from front to back
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+  // the mapping keeps the file alive
+  close(fd);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void MappedFile::Evict(const size_t offset, const size_t len) {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  // only whole pages inside the range can be dropped
+  const size_t begin = (offset + page - 1) / page * page;
+  const size_t end = std::min(offset + len, size_) / page * page;
+  if (begin < end) {
+    madvise(data_ + begin, end - begin, MADV_DONTNEED);
+  }
+}
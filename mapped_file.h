@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A read-only memory mapping of a whole file (POSIX only). The pages are
+// backed by the page cache, so reading a model through it does not count
+// a second copy of the model against the process.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { Close(); }
+
+  bool Open(const std::string &path);
+  void Close();
+
+  const unsigned char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Drop the pages of [offset, offset + len) once they have been consumed,
+  // they are read from the file again if touched later
+  void Evict(size_t offset, size_t len);
+
+ private:
+  unsigned char *data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,143 @@
+#include "mem_files.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+const char kMemFilePrefix[] = "/wmc-mem/";
+
+namespace {
+
+struct MemFile {
+  std::string data;
+  // the buffer of open_memstream while the file is written, it becomes
+  // data when the file is next used
+  char *stream = nullptr;
+  size_t stream_size = 0;
+};
+
+struct MemFiles {
+  std::mutex mutex;
+  // nodes of a map do not move, open_memstream keeps pointers into them
+  std::map<std::string, MemFile> files;
+};
+
+MemFiles &Files() {
+  static MemFiles files;
+  return files;
+}
+
+// Only called with the lock held
+void Settle(MemFile *file) {
+  if (file->stream != nullptr) {
+    file->data.assign(file->stream, file->stream_size);
+    free(file->stream);
+    file->stream = nullptr;
+    file->stream_size = 0;
+  }
+}
+
+bool IsMemPath(const char *path) {
+  return strncmp(path, kMemFilePrefix, sizeof(kMemFilePrefix) - 1) == 0;
+}
+
+// fopen of libc in terms of open and fdopen, which are not interposed
+FILE *OpenFile(const char *path, const char *mode) {
+  int flags = strchr(mode, '+') != nullptr ? O_RDWR
+              : mode[0] == 'r'            ? O_RDONLY
+                                          : O_WRONLY;
+  if (mode[0] == 'w') {
+    flags |= O_CREAT | O_TRUNC;
+  } else if (mode[0] == 'a') {
+    flags |= O_CREAT | O_APPEND;
+  } else if (mode[0] != 'r') {
+    errno = EINVAL;
+    return nullptr;
+  }
+  if (strchr(mode, 'x') != nullptr) {
+    flags |= O_EXCL;
+  }
+  if (strchr(mode, 'e') != nullptr) {
+    flags |= O_CLOEXEC;
+  }
+  const int fd = open(path, flags, 0666);
+  if (fd < 0) {
+    return nullptr;
+  }
+  FILE *f = fdopen(fd, mode);
+  if (f == nullptr) {
+    close(fd);
+  }
+  return f;
+}
+
+FILE *OpenMemFile(const char *path, const char *mode) {
+  auto &files = Files();
+  std::lock_guard<std::mutex> lock(files.mutex);
+  if (mode[0] == 'r') {
+    const auto it = files.files.find(path);
+    if (it == files.files.end()) {
+      errno = ENOENT;
+      return nullptr;
+    }
+    Settle(&it->second);
+    auto &data = it->second.data;
+    // fmemopen rejects an empty buffer
+    return data.empty() ? OpenFile("/dev/null", mode)
+                        : fmemopen(&data[0], data.size(), "r");
+  }
+  // "w" and "a", the tools never append
+  auto &file = files.files[path];
+  Settle(&file);
+  file.data.clear();
+  return open_memstream(&file.stream, &file.stream_size);
+}
+
+}  // namespace
+
+void SetMemFile(const std::string &path, std::string data) {
+  auto &files = Files();
+  std::lock_guard<std::mutex> lock(files.mutex);
+  auto &file = files.files[path];
+  free(file.stream);
+  file.stream = nullptr;
+  file.stream_size = 0;
+  file.data = std::move(data);
+}
+
+bool TakeMemFile(const std::string &path, std::string *data) {
+  auto &files = Files();
+  std::lock_guard<std::mutex> lock(files.mutex);
+  const auto it = files.files.find(path);
+  if (it == files.files.end()) {
+    return false;
+  }
+  Settle(&it->second);
+  *data = std::move(it->second.data);
+  files.files.erase(it);
+  return true;
+}
+
+void RemoveMemFile(const std::string &path) {
+  auto &files = Files();
+  std::lock_guard<std::mutex> lock(files.mutex);
+  const auto it = files.files.find(path);
+  if (it != files.files.end()) {
+    free(it->second.stream);
+    files.files.erase(it);
+  }
+}
+
+extern "C" FILE *fopen(const char *path, const char *mode) {
+  if (path == nullptr || mode == nullptr) {
+    errno = EINVAL;
+    return nullptr;
+  }
+  return IsMemPath(path) ? OpenMemFile(path, mode) : OpenFile(path, mode);
+}
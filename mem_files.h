@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+// Files that live in memory, under kMemFilePrefix. fopen of the whole
+// program is interposed (like malloc in alloc_stats.cpp), so that code which
+// only takes paths, e.g. the ncnn tools and ncnn::Net::load_param, reads and
+// writes them without a file system. Other paths are opened as usual.
+//
+// A file opened for reading is a view of its contents and a file opened for
+// writing replaces them once it is closed, so a file must not be set, taken
+// or removed while a FILE of it is open.
+extern const char kMemFilePrefix[];
+
+void SetMemFile(const std::string &path, std::string data);
+// move the contents of path into data, false if there is no such file
+bool TakeMemFile(const std::string &path, std::string *data);
+void RemoveMemFile(const std::string &path);
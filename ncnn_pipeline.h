@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// onnx2ncnn and ncnnoptimize of ncnn (third_party/ncnn/tools) as functions,
+// for onnx2ncnn_export. The tools are command line programs, their main
+// functions are compiled in under other names and run on in-memory files
+// (see mem_files.h) instead of files of the emscripten file system.
+
+// Convert model to ncnn, model is taken over and left empty. messages is
+// what onnx2ncnn printed to stderr, e.g. the unsupported operators of an
+// otherwise complete conversion. Returns false if onnx2ncnn failed.
+bool OnnxToNcnn(onnx::ModelProto *model, std::string *param, std::string *bin,
+                std::string *messages);
+
+// Run ncnnoptimize on the ncnn model in place, fp16 stores the weights in
+// half precision
+bool OptimizeNcnn(std::string *param, std::string *bin, bool fp16);
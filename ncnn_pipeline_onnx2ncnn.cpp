@@ -0,0 +1,129 @@
+// OnnxToNcnn of ncnn_pipeline.h. tools/onnx/onnx2ncnn.cpp of ncnn is
+// compiled into this file with its main renamed, its model is handed over
+// in memory and its stderr is captured.
+
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/text_format.h>
+
+// ncnn_wrapper/pipeline/onnx.pb.h
+#include "onnx.pb.h"
+
+#include "mem_files.h"
+#include "ncnn_pipeline.h"
+
+namespace {
+
+// Inserted between the arguments of read_proto_from_binary by the macro
+// below. In the definition of the tool `ModelTag()` is an unnamed function
+// pointer parameter, which leaves it an unused overload; in its call it is
+// a ModelTag, which selects ReadModel. This works whether the tool takes
+// onnx::ModelProto* or google::protobuf::Message*.
+struct ModelTag {};
+
+// the model of the running OnnxToNcnn and where its stderr goes
+onnx::ModelProto *g_model = nullptr;
+FILE *g_messages = nullptr;
+
+FILE *MessageStream() { return g_messages != nullptr ? g_messages : stderr; }
+
+}  // namespace
+
+static bool ReadModel(const char *, ModelTag, onnx::ModelProto *model) {
+  if (g_model == nullptr) {
+    return false;
+  }
+  model->Swap(g_model);
+  return true;
+}
+
+#define read_proto_from_binary(path, message) \
+  ReadModel(path, ModelTag(), message)
+#define main onnx2ncnn_main
+#undef stderr
+#define stderr MessageStream()
+
+// the definition of the tool is left unused, see ModelTag
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include <ncnn/tools/onnx/onnx2ncnn.cpp>
+#pragma GCC diagnostic pop
+
+#undef stderr
+#undef main
+#undef read_proto_from_binary
+
+namespace {
+
+// The state of one run of the tool, reset on every way out
+class ToolRun {
+ public:
+  explicit ToolRun(onnx::ModelProto *model) {
+    g_model = model;
+    g_messages = open_memstream(&messages_, &messages_len_);
+  }
+  ~ToolRun() {
+    g_model = nullptr;
+    if (g_messages != nullptr) {
+      fclose(g_messages);
+      g_messages = nullptr;
+    }
+    free(messages_);
+  }
+  ToolRun(const ToolRun &) = delete;
+  ToolRun &operator=(const ToolRun &) = delete;
+
+  std::string Messages() {
+    if (g_messages == nullptr) {
+      return "";
+    }
+    fflush(g_messages);
+    return std::string(messages_, messages_len_);
+  }
+
+ private:
+  char *messages_ = nullptr;
+  size_t messages_len_ = 0;
+};
+
+}  // namespace
+
+bool OnnxToNcnn(onnx::ModelProto *model, std::string *param, std::string *bin,
+                std::string *messages) {
+  const std::string param_path = std::string(kMemFilePrefix) + "onnx2ncnn.param";
+  const std::string bin_path = std::string(kMemFilePrefix) + "onnx2ncnn.bin";
+  std::vector<std::string> args = {"onnx2ncnn", "model.onnx", param_path,
+                                   bin_path};
+  std::vector<char *> argv;
+  for (auto &x : args) {
+    argv.push_back(&x[0]);
+  }
+  argv.push_back(nullptr);
+  int ret;
+  {
+    ToolRun run(model);
+    ret = onnx2ncnn_main(static_cast<int>(args.size()), argv.data());
+    *messages = run.Messages();
+  }
+  const bool ok = ret == 0 && TakeMemFile(param_path, param) &&
+                  TakeMemFile(bin_path, bin);
+  RemoveMemFile(param_path);
+  RemoveMemFile(bin_path);
+  return ok;
+}
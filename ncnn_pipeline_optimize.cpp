@@ -0,0 +1,41 @@
+// OptimizeNcnn of ncnn_pipeline.h. tools/ncnnoptimize.cpp of ncnn is
+// compiled into this file with its main renamed. It reads and writes the
+// model through ncnn::Net and fopen, which open the in-memory files.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mem_files.h"
+#include "ncnn_pipeline.h"
+
+#define main ncnnoptimize_main
+
+#include <ncnn/tools/ncnnoptimize.cpp>
+
+#undef main
+
+bool OptimizeNcnn(std::string *param, std::string *bin, const bool fp16) {
+  const std::string prefix(kMemFilePrefix);
+  const std::string in_param = prefix + "ncnnoptimize-in.param";
+  const std::string in_bin = prefix + "ncnnoptimize-in.bin";
+  const std::string out_param = prefix + "ncnnoptimize-out.param";
+  const std::string out_bin = prefix + "ncnnoptimize-out.bin";
+  SetMemFile(in_param, std::move(*param));
+  SetMemFile(in_bin, std::move(*bin));
+  // the flag the page passes to ncnnoptimize, 1 for fp16 weights
+  std::vector<std::string> args = {"ncnnoptimize", in_param, in_bin,
+                                   out_param,      out_bin,  fp16 ? "1" : "0"};
+  std::vector<char *> argv;
+  for (auto &x : args) {
+    argv.push_back(&x[0]);
+  }
+  argv.push_back(nullptr);
+  const int ret = ncnnoptimize_main(static_cast<int>(args.size()), argv.data());
+  const bool ok = ret == 0 && TakeMemFile(out_param, param) &&
+                  TakeMemFile(out_bin, bin);
+  for (const auto &path : {in_param, in_bin, out_param, out_bin}) {
+    RemoveMemFile(path);
+  }
+  return ok;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// onnx2ncnn of ncnn includes the onnx.pb.h generated from its own copy of
+// onnx.proto. In the ncnn pipeline (see ncnn_pipeline.h) it is compiled
+// against the onnx of the exporter instead, so that both share
+// onnx::ModelProto and the model is handed over without serializing it.
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include <google/protobuf/arena.h>
+
+// Options of the arena that a serialized model of `len` bytes is parsed
+// into. Tensor payloads, which are the bulk of a big model, still live in
+// their own strings, so the arena only has to hold the message objects.
+// Those grow with the number of nodes and tensors, roughly 1/32 of the
+// model size for typical cnn models.
+inline google::protobuf::ArenaOptions ModelArenaOptions(const size_t len) {
+  const size_t kMinBlockSize = 64 * 1024;
+  const size_t kMaxBlockSize = 16 * 1024 * 1024;
+  google::protobuf::ArenaOptions options;
+  options.start_block_size =
+      std::min(std::max(len / 32, kMinBlockSize), kMaxBlockSize);
+  options.max_block_size = kMaxBlockSize;
+  return options;
+}
@@ -0,0 +1,171 @@
+#include "onnx_passes.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "content_hash.h"
+#include "graph_index.h"
+
+void add_initer_to_inputs(onnx::ModelProto &model) {
+  auto *graph = model.mutable_graph();
+  // The python version recomputes the input names on every iteration, so
+  // an initializer whose name repeats is added once. Every added input is
+  // recorded in the index for that.
+  GraphIndex index(*graph);
+  const int initer_size = graph->initializer_size();
+  for (int i = 0; i < initer_size; i++) {
+    const auto &x = graph->initializer(i);
+    if (!index.IsInput(x.name())) {
+      auto *value_info = graph->add_input();
+      value_info->set_name(x.name());
+      index.AddInput(*graph, graph->input_size() - 1);
+      onnx::TypeProto *type = value_info->mutable_type();
+      auto *tensor = type->mutable_tensor_type();
+      tensor->set_elem_type(x.data_type());
+      auto *shape = tensor->mutable_shape();
+      for (const auto &dim : x.dims()) {
+        onnx::TensorShapeProto::Dimension *new_dim = shape->add_dim();
+        new_dim->set_dim_value(dim);
+      }
+    }
+  }
+}
+
+namespace {
+
+// The data of a tensor as bytes. Tensors in raw_data are compared in
+// place, the rare ones in typed fields (float_data, ...) by their encoding
+// without name and doc_string.
+const std::string &TensorData(const onnx::TensorProto &tensor,
+                              std::string *storage) {
+  if (tensor.has_raw_data()) {
+    return tensor.raw_data();
+  }
+  onnx::TensorProto copy = tensor;
+  copy.clear_name();
+  copy.clear_doc_string();
+  copy.SerializeToString(storage);
+  return *storage;
+}
+
+bool SameShapeAndType(const onnx::TensorProto &a, const onnx::TensorProto &b) {
+  if (a.data_type() != b.data_type() || a.dims_size() != b.dims_size() ||
+      a.has_raw_data() != b.has_raw_data()) {
+    return false;
+  }
+  for (int i = 0; i < a.dims_size(); i++) {
+    if (a.dims(i) != b.dims(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RenameInputs(
+    onnx::GraphProto *graph,
+    const std::unordered_map<std::string, std::string> &renamed) {
+  for (auto &node : *graph->mutable_node()) {
+    for (auto &input : *node.mutable_input()) {
+      const auto it = renamed.find(input);
+      if (it != renamed.end()) {
+        input = it->second;
+      }
+    }
+    for (auto &attr : *node.mutable_attribute()) {
+      if (attr.has_g()) {
+        RenameInputs(attr.mutable_g(), renamed);
+      }
+      for (auto &g : *attr.mutable_graphs()) {
+        RenameInputs(&g, renamed);
+      }
+    }
+  }
+}
+
+// drop the entries of a graph.input or graph.value_info list that are named
+// after a removed initializer
+void RemoveRenamed(
+    google::protobuf::RepeatedPtrField<onnx::ValueInfoProto> *list,
+    const std::unordered_map<std::string, std::string> &renamed) {
+  int n = 0;
+  for (int i = 0; i < list->size(); i++) {
+    if (renamed.count(list->Get(i).name()) == 0) {
+      list->SwapElements(i, n++);
+    }
+  }
+  list->DeleteSubrange(n, list->size() - n);
+}
+
+}  // namespace
+
+DedupeStats DedupeInitializers(onnx::ModelProto &model) {
+  DedupeStats stats;
+  auto *graph = model.mutable_graph();
+  const GraphIndex index(*graph);
+  const int initer_size = graph->initializer_size();
+  // Before IR version 4 every initializer had to be listed in graph.input,
+  // so a listed one is not meant to be fed and is deduplicated along with
+  // its input
+  const bool inputs_list_initializers = model.ir_version() < 4;
+
+  // the storage of tensors without raw_data, by initializer index
+  std::vector<std::string> storage(initer_size);
+  // hash of data, dims and type -> initializers kept so far
+  std::unordered_map<uint64_t, std::vector<int>> kept;
+  std::unordered_map<std::string, std::string> renamed;
+  std::vector<bool> removed(initer_size, false);
+  for (int i = 0; i < initer_size; i++) {
+    const auto &x = graph->initializer(i);
+    const auto *entry = index.Find(x.name());
+    if ((entry->input != -1 && !inputs_list_initializers) ||
+        entry->output != -1 ||
+        x.data_location() == onnx::TensorProto::EXTERNAL) {
+      continue;
+    }
+    const std::string &data = TensorData(x, &storage[i]);
+    uint64_t seed = x.data_type();
+    for (const auto dim : x.dims()) {
+      seed = seed * 31 + dim;
+    }
+    auto &candidates = kept[StripeHash(data.data(), data.size(), seed)];
+    bool found = false;
+    for (const int j : candidates) {
+      const auto &y = graph->initializer(j);
+      const std::string &other = TensorData(y, &storage[j]);
+      if (SameShapeAndType(x, y) && data.size() == other.size() &&
+          memcmp(data.data(), other.data(), data.size()) == 0) {
+        renamed[x.name()] = y.name();
+        removed[i] = true;
+        stats.removed++;
+        stats.bytes_saved += data.size();
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      candidates.push_back(i);
+    }
+  }
+  if (renamed.empty()) {
+    return stats;
+  }
+
+  RenameInputs(graph, renamed);
+  // drop the removed initializers, their value_info and inputs in one pass
+  // each
+  auto *initializers = graph->mutable_initializer();
+  int n = 0;
+  for (int i = 0; i < initer_size; i++) {
+    if (!removed[i]) {
+      initializers->SwapElements(i, n++);
+    }
+  }
+  initializers->DeleteSubrange(n, initer_size - n);
+  RemoveRenamed(graph->mutable_value_info(), renamed);
+  if (inputs_list_initializers) {
+    RemoveRenamed(graph->mutable_input(), renamed);
+  }
+  return stats;
+}
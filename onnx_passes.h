@@ -0,0 +1,34 @@
+#pragma once
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// Graph passes on ModelProto shared by the export entry points
+
+// for x in model.graph.initializer:
+//     input_names = [x.name for x in model.graph.input]
+//     if x.name not in input_names:
+//         shape = onnx.TensorShapeProto()
+//         for dim in x.dims:
+//             shape.dim.extend([onnx.TensorShapeProto.Dimension(dim_value=dim)])
+//         model.graph.input.extend(
+//             [onnx.ValueInfoProto(name=x.name,
+//                                  type=onnx.TypeProto(tensor_type=onnx.TypeProto.Tensor(elem_type=x.data_type,
+//                                                                                        shape=shape)))])
+// return model
+void add_initer_to_inputs(onnx::ModelProto &model);
+
+struct DedupeStats {
+  // initializers removed and the bytes of tensor data they held
+  size_t removed = 0;
+  size_t bytes_saved = 0;
+};
+
+// Replace initializers of the main graph that are byte-identical (same
+// data type, dims and data) to an earlier one by that one, and rewire the
+// nodes that consume them, including those in subgraphs. Initializers that
+// are graph outputs are kept, and so are those that are graph inputs
+// (overridable) from IR version 4 on. Older models list every initializer
+// as an input, there the inputs of removed initializers are removed too.
+// Must run before add_initer_to_inputs, which makes every initializer an
+// input.
+DedupeStats DedupeInitializers(onnx::ModelProto &model);
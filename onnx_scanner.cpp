@@ -0,0 +1,227 @@
+#include "onnx_scanner.h"
+
+#include <cstdint>
+#include <string>
+
+namespace {
+
+// Field numbers in onnx.proto
+const uint32_t kModelIrVersion = 1;
+const uint32_t kModelGraph = 7;
+const uint32_t kModelOpsetImport = 8;
+const uint32_t kGraphName = 2;
+const uint32_t kGraphInitializer = 5;
+const uint32_t kGraphInput = 11;
+const uint32_t kGraphOutput = 12;
+const uint32_t kGraphValueInfo = 13;
+const uint32_t kTensorDims = 1;
+const uint32_t kTensorDataType = 2;
+const uint32_t kTensorName = 8;
+
+enum WireType {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kStartGroup = 3,
+  kEndGroup = 4,
+  kFixed32 = 5,
+};
+
+// A cursor over protobuf wire format. Unlike CodedInputStream it has no
+// total bytes limit and uses size_t lengths, so models over 2 GB can be
+// walked.
+class WireReader {
+ public:
+  WireReader(const uint8_t *begin, const uint8_t *end) : p_(begin), end_(end) {}
+
+  bool Done() const { return p_ == end_; }
+
+  bool ReadVarint(uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p_ < end_; shift += 7) {
+      const uint8_t byte = *p_++;
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadTag(uint32_t *field, WireType *wire_type) {
+    uint64_t tag;
+    if (!ReadVarint(&tag) || (tag >> 3) == 0) {
+      return false;
+    }
+    *field = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<WireType>(tag & 7);
+    return true;
+  }
+
+  bool ReadLengthDelimited(WireReader *sub) {
+    uint64_t len;
+    if (!ReadVarint(&len) || len > static_cast<uint64_t>(end_ - p_)) {
+      return false;
+    }
+    *sub = WireReader(p_, p_ + len);
+    p_ += len;
+    return true;
+  }
+
+  bool ReadString(std::string *str) {
+    WireReader sub(nullptr, nullptr);
+    if (!ReadLengthDelimited(&sub)) {
+      return false;
+    }
+    str->assign(reinterpret_cast<const char *>(sub.p_), sub.end_ - sub.p_);
+    return true;
+  }
+
+  template <typename Message>
+  bool ReadMessage(Message *message) {
+    WireReader sub(nullptr, nullptr);
+    return ReadLengthDelimited(&sub) &&
+           message->ParseFromArray(sub.p_, static_cast<int>(sub.end_ - sub.p_));
+  }
+
+  bool Skip(const WireType wire_type) {
+    switch (wire_type) {
+      case kVarint: {
+        uint64_t value;
+        return ReadVarint(&value);
+      }
+      case kFixed64:
+        return Advance(8);
+      case kFixed32:
+        return Advance(4);
+      case kLengthDelimited: {
+        WireReader sub(nullptr, nullptr);
+        return ReadLengthDelimited(&sub);
+      }
+      default:
+        // groups are not used by onnx
+        return false;
+    }
+  }
+
+ private:
+  bool Advance(const size_t n) {
+    if (n > static_cast<size_t>(end_ - p_)) {
+      return false;
+    }
+    p_ += n;
+    return true;
+  }
+
+  const uint8_t *p_;
+  const uint8_t *end_;
+};
+
+bool ScanTensorHeader(WireReader reader, onnx::TensorProto *tensor) {
+  uint32_t field;
+  WireType wire_type;
+  while (!reader.Done()) {
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return false;
+    }
+    uint64_t value;
+    if (field == kTensorDims && wire_type == kVarint) {
+      if (!reader.ReadVarint(&value)) {
+        return false;
+      }
+      tensor->add_dims(static_cast<int64_t>(value));
+    } else if (field == kTensorDims && wire_type == kLengthDelimited) {
+      // packed
+      WireReader packed(nullptr, nullptr);
+      if (!reader.ReadLengthDelimited(&packed)) {
+        return false;
+      }
+      while (!packed.Done()) {
+        if (!packed.ReadVarint(&value)) {
+          return false;
+        }
+        tensor->add_dims(static_cast<int64_t>(value));
+      }
+    } else if (field == kTensorDataType && wire_type == kVarint) {
+      if (!reader.ReadVarint(&value)) {
+        return false;
+      }
+      tensor->set_data_type(static_cast<int32_t>(value));
+    } else if (field == kTensorName && wire_type == kLengthDelimited) {
+      if (!reader.ReadString(tensor->mutable_name())) {
+        return false;
+      }
+    } else if (!reader.Skip(wire_type)) {
+      // raw_data and the typed data fields end up here
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ScanGraph(WireReader reader, onnx::GraphProto *graph) {
+  uint32_t field;
+  WireType wire_type;
+  while (!reader.Done()) {
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return false;
+    }
+    bool ok;
+    if (wire_type != kLengthDelimited) {
+      ok = reader.Skip(wire_type);
+    } else if (field == kGraphName) {
+      ok = reader.ReadString(graph->mutable_name());
+    } else if (field == kGraphInput) {
+      ok = reader.ReadMessage(graph->add_input());
+    } else if (field == kGraphOutput) {
+      ok = reader.ReadMessage(graph->add_output());
+    } else if (field == kGraphValueInfo) {
+      ok = reader.ReadMessage(graph->add_value_info());
+    } else if (field == kGraphInitializer) {
+      WireReader sub(nullptr, nullptr);
+      ok = reader.ReadLengthDelimited(&sub) &&
+           ScanTensorHeader(sub, graph->add_initializer());
+    } else {
+      // nodes end up here
+      ok = reader.Skip(wire_type);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ScanModelInterface(const void *buf, const size_t len,
+                        onnx::ModelProto *model) {
+  const auto *begin = static_cast<const uint8_t *>(buf);
+  WireReader reader(begin, begin + len);
+  uint32_t field;
+  WireType wire_type;
+  while (!reader.Done()) {
+    if (!reader.ReadTag(&field, &wire_type)) {
+      return false;
+    }
+    bool ok;
+    if (field == kModelIrVersion && wire_type == kVarint) {
+      uint64_t value = 0;
+      ok = reader.ReadVarint(&value);
+      model->set_ir_version(static_cast<int64_t>(value));
+    } else if (field == kModelOpsetImport && wire_type == kLengthDelimited) {
+      ok = reader.ReadMessage(model->add_opset_import());
+    } else if (field == kModelGraph && wire_type == kLengthDelimited) {
+      WireReader sub(nullptr, nullptr);
+      ok = reader.ReadLengthDelimited(&sub) &&
+           ScanGraph(sub, model->mutable_graph());
+    } else {
+      ok = reader.Skip(wire_type);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// Decode the interface of a serialized ModelProto by walking its wire format:
+// ir_version, opset_import, and graph.input/output/value_info, plus the
+// name, data_type and dims of every graph.initializer. Nodes and tensor
+// payloads are skipped by their length without being read, so this takes
+// milliseconds and allocates almost nothing even for a 1 GB model.
+//
+// The result is a ModelProto holding only the fields above, which the usual
+// graph utilities (GetInputNames, CheckStaticInputShape, ...) accept.
+// Returns false if buf is not a valid ModelProto.
+bool ScanModelInterface(const void *buf, size_t len, onnx::ModelProto *model);
@@ -0,0 +1,124 @@
+#include "phase_timer.h"
+
+#include <cstdio>
+
+#include "log.h"
+
+PhaseTimer::PhaseTimer()
+    : start_(std::chrono::steady_clock::now()),
+      saved_peak_(ResetPeakAllocBytes()) {}
+
+PhaseTimer::~PhaseTimer() {
+  EndAll();
+  RestorePeakAllocBytes(saved_peak_);
+}
+
+void PhaseTimer::Begin(const char *name) {
+  open_.push_back(phases_.size());
+  Phase phase;
+  phase.name = name;
+  phase.start_ms = ElapsedMs();
+  phase.duration_ms = 0;
+  phase.depth = static_cast<int>(open_.size()) - 1;
+  phase.peak_bytes = 0;
+  phases_.push_back(std::move(phase));
+  // after the push_back, so that its allocation is not part of the phase
+  saved_peaks_.push_back(ResetPeakAllocBytes());
+  phases_.back().alloc_begin = CurrentAllocStats();
+}
+
+void PhaseTimer::End() {
+  if (open_.empty()) {
+    return;
+  }
+  auto &phase = phases_[open_.back()];
+  phase.duration_ms = ElapsedMs() - phase.start_ms;
+  phase.alloc_end = CurrentAllocStats();
+  phase.peak_bytes = phase.alloc_end.peak_bytes;
+  // the peak of a phase is part of the peak of its parent
+  RestorePeakAllocBytes(saved_peaks_.back());
+  saved_peaks_.pop_back();
+  open_.pop_back();
+  // the log is delivered in one batch per top-level phase
+  if (open_.empty()) {
+    FlushLog();
+  }
+}
+
+void PhaseTimer::EndAll() {
+  while (!open_.empty()) {
+    End();
+  }
+}
+
+double PhaseTimer::ElapsedMs() const {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start_)
+      .count();
+}
+
+// phase names are identifiers chosen by the exporters, never escaped
+std::string PhaseTimer::ToJson() const {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "{\"total_ms\": %.3f, \"phases\": [",
+           ElapsedMs());
+  std::string res = buf;
+  for (size_t i = 0; i < phases_.size(); i++) {
+    const auto &x = phases_[i];
+    snprintf(buf, sizeof(buf),
+             "\"start_ms\": %.3f, \"duration_ms\": %.3f, \"depth\": %d}",
+             x.start_ms, x.duration_ms, x.depth);
+    res += (i == 0 ? "" : ", ") + std::string("{\"name\": \"") + x.name +
+           "\", " + buf;
+  }
+  return res + "]}";
+}
+
+std::string PhaseTimer::ToChromeTrace() const {
+  std::string res = "{\"traceEvents\": [";
+  for (size_t i = 0; i < phases_.size(); i++) {
+    const auto &x = phases_[i];
+    // microseconds
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "\"ph\": \"X\", \"ts\": %.1f, \"dur\": %.1f, \"pid\": 1, "
+             "\"tid\": 1}",
+             x.start_ms * 1000, x.duration_ms * 1000);
+    res += (i == 0 ? "" : ", ") + std::string("{\"name\": \"") + x.name +
+           "\", \"cat\": \"export\", " + buf;
+    // a counter ("C") track of the allocated bytes at the phase boundaries
+    if (AllocStatsEnabled()) {
+      snprintf(buf, sizeof(buf),
+               ", {\"name\": \"allocated\", \"ph\": \"C\", \"ts\": %.1f, "
+               "\"pid\": 1, \"args\": {\"bytes\": %zu}}, {\"name\": "
+               "\"allocated\", \"ph\": \"C\", \"ts\": %.1f, \"pid\": 1, "
+               "\"args\": {\"bytes\": %zu}}",
+               x.start_ms * 1000, x.alloc_begin.current_bytes,
+               (x.start_ms + x.duration_ms) * 1000, x.alloc_end.current_bytes);
+      res += buf;
+    }
+  }
+  return res + "], \"displayTimeUnit\": \"ms\"}";
+}
+
+std::string PhaseTimer::ToMemoryJson() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"enabled\": %s, \"peak_bytes\": %zu, \"phases\": [",
+           AllocStatsEnabled() ? "true" : "false",
+           CurrentAllocStats().peak_bytes);
+  std::string res = buf;
+  for (size_t i = 0; i < phases_.size(); i++) {
+    const auto &x = phases_[i];
+    snprintf(buf, sizeof(buf),
+             "\"depth\": %d, \"bytes_begin\": %zu, \"bytes_end\": %zu, "
+             "\"peak_bytes\": %zu, \"allocations\": %zu, \"frees\": %zu, "
+             "\"heap_size\": %zu}",
+             x.depth, x.alloc_begin.current_bytes, x.alloc_end.current_bytes,
+             x.peak_bytes, x.alloc_end.allocations - x.alloc_begin.allocations,
+             x.alloc_end.frees - x.alloc_begin.frees, x.alloc_end.heap_size);
+    res += (i == 0 ? "" : ", ") + std::string("{\"name\": \"") + x.name +
+           "\", " + buf;
+  }
+  return res + "]}";
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "alloc_stats.h"
+
+// Monotonic wall-clock timings of the phases of a conversion. Phases may
+// nest, a phase that begins before the current one ends is its child. The
+// allocation stats (see alloc_stats.h) are taken at every phase boundary.
+class PhaseTimer {
+ public:
+  struct Phase {
+    std::string name;
+    // relative to the construction of the timer
+    double start_ms;
+    double duration_ms;
+    int depth;
+    AllocStats alloc_begin;
+    AllocStats alloc_end;
+    // the most bytes allocated at once while the phase ran
+    size_t peak_bytes;
+  };
+
+  PhaseTimer();
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+  ~PhaseTimer();
+
+  void Begin(const char *name);
+  // ends the innermost phase that has not ended, the end of a top-level
+  // phase flushes the log (see log.h)
+  void End();
+  // ends every phase that has not ended, e.g. after an early return
+  void EndAll();
+  double ElapsedMs() const;
+
+  const std::vector<Phase> &phases() const { return phases_; }
+
+  // {"total_ms": .., "phases": [{"name": .., "start_ms": .., ...}]}
+  std::string ToJson() const;
+  // the trace event format of chrome://tracing and Perfetto, one complete
+  // ("X") event per phase
+  std::string ToChromeTrace() const;
+  // {"enabled": .., "peak_bytes": .., "phases": [{"name": ..,
+  // "bytes_begin": .., "bytes_end": .., "peak_bytes": .., ...}]}, the peak
+  // at the top level is the one since the construction of the timer
+  std::string ToMemoryJson() const;
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  std::vector<Phase> phases_;
+  // indices of the phases that have begun but not ended
+  std::vector<size_t> open_;
+  // the peaks that were running when the timer and the open phases began
+  size_t saved_peak_;
+  std::vector<size_t> saved_peaks_;
+};
+
+// A phase that ends when the scope is left, by return or by exception
+class PhaseScope {
+ public:
+  PhaseScope(PhaseTimer *timer, const char *name) : timer_(timer) {
+    timer_->Begin(name);
+  }
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+  ~PhaseScope() { timer_->End(); }
+
+ private:
+  PhaseTimer *timer_;
+};
@@ -0,0 +1,234 @@
+#include "result_cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#ifndef __EMSCRIPTEN__
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#include "content_hash.h"
+
+size_t CachedConversion::bytes() const {
+  size_t n = 0;
+  for (const auto &x : results) {
+    n += x.size;
+  }
+  return n;
+}
+
+bool MemoryResultStore::Get(const std::string &key, CachedConversion *value) {
+  const auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  items_.splice(items_.begin(), items_, it->second);
+  *value = it->second->second;
+  return true;
+}
+
+void MemoryResultStore::Put(const std::string &key,
+                            const CachedConversion &value) {
+  const size_t bytes = value.bytes();
+  if (bytes > capacity_ || bytes > max_bytes_) {
+    return;
+  }
+  const auto it = index_.find(key);
+  if (it != index_.end()) {
+    size_ -= it->second->second.bytes();
+    items_.erase(it->second);
+    index_.erase(it);
+  }
+  while (!items_.empty() && size_ + bytes > capacity_) {
+    size_ -= items_.back().second.bytes();
+    index_.erase(items_.back().first);
+    items_.pop_back();
+  }
+  items_.emplace_front(key, value);
+  index_[key] = items_.begin();
+  size_ += bytes;
+}
+
+void MemoryResultStore::Clear() {
+  index_.clear();
+  items_.clear();
+  size_ = 0;
+}
+
+#ifndef __EMSCRIPTEN__
+// File layout, all integers little-endian:
+//   "WMCC", u32 key size, key, i32 ret, u32 result count,
+//   then for every result: i32 kind, u64 size, bytes
+namespace {
+
+const char kMagic[4] = {'W', 'M', 'C', 'C'};
+
+template <typename T>
+bool ReadPod(const std::string &buf, size_t *pos, T *v) {
+  if (buf.size() - *pos < sizeof(T)) {
+    return false;
+  }
+  memcpy(v, buf.data() + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+template <typename T>
+bool WritePod(FILE *fp, const T &v) {
+  return fwrite(&v, sizeof(T), 1, fp) == 1;
+}
+
+}  // namespace
+
+std::string DirectoryResultStore::Path(const std::string &key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016" PRIx64 ".wmcc",
+           ContentHash(key.data(), key.size()));
+  return dir_ + "/" + name;
+}
+
+bool DirectoryResultStore::Get(const std::string &key,
+                               CachedConversion *value) {
+  FILE *fp = fopen(Path(key).c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  auto buf = std::make_shared<std::string>();
+  char tmp[65536];
+  size_t n;
+  while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0) {
+    buf->append(tmp, n);
+  }
+  fclose(fp);
+
+  size_t pos = sizeof(kMagic);
+  uint32_t key_size;
+  if (buf->compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0 ||
+      !ReadPod(*buf, &pos, &key_size) || buf->size() - pos < key_size ||
+      buf->compare(pos, key_size, key) != 0) {
+    // corrupted, or another key with the same file name
+    return false;
+  }
+  pos += key_size;
+  CachedConversion res;
+  uint32_t count;
+  if (!ReadPod(*buf, &pos, &res.ret) || !ReadPod(*buf, &pos, &count)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    WasmResult x;
+    uint64_t size;
+    if (!ReadPod(*buf, &pos, &x.kind) || !ReadPod(*buf, &pos, &size) ||
+        buf->size() - pos < size) {
+      return false;
+    }
+    // the outputs point into the file contents, which they keep alive
+    x.data = reinterpret_cast<const unsigned char *>(buf->data()) + pos;
+    x.size = size;
+    x.owner = buf;
+    pos += size;
+    res.results.push_back(std::move(x));
+  }
+  *value = std::move(res);
+  return true;
+}
+
+void DirectoryResultStore::Put(const std::string &key,
+                               const CachedConversion &value) {
+  const std::string path = Path(key);
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  FILE *fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == nullptr) {
+    return;
+  }
+  bool ok = fwrite(kMagic, sizeof(kMagic), 1, fp) == 1 &&
+            WritePod(fp, static_cast<uint32_t>(key.size())) &&
+            fwrite(key.data(), 1, key.size(), fp) == key.size() &&
+            WritePod(fp, value.ret) &&
+            WritePod(fp, static_cast<uint32_t>(value.results.size()));
+  for (const auto &x : value.results) {
+    ok = ok && WritePod(fp, x.kind) &&
+         WritePod(fp, static_cast<uint64_t>(x.size)) &&
+         fwrite(x.data, 1, x.size, fp) == x.size;
+  }
+  ok = fclose(fp) == 0 && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    remove(tmp_path.c_str());
+  }
+}
+
+void DirectoryResultStore::Clear() {
+  DIR *dir = opendir(dir_.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  while (const auto *ent = readdir(dir)) {
+    const std::string name = ent->d_name;
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".wmcc") == 0) {
+      remove((dir_ + "/" + name).c_str());
+    }
+  }
+  closedir(dir);
+}
+#endif
+
+void ResultCache::SetStore(std::unique_ptr<ResultStore> store) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  store_ = std::move(store);
+}
+
+std::string ResultCache::Key(const char *target, const void *input,
+                             const size_t len, const std::string &options) {
+  char hash[48];
+  snprintf(hash, sizeof(hash), ":%016" PRIx64 ":%zu:",
+           ContentHash(input, len), len);
+  return target + std::string(hash) + options;
+}
+
+bool ResultCache::Lookup(const std::string &key, WasmBuffer *ctx,
+                         int32_t *ret) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (store_ == nullptr) {
+    return false;
+  }
+  CachedConversion value;
+  if (!store_->Get(key, &value)) {
+    misses_++;
+    return false;
+  }
+  hits_++;
+  for (auto &x : value.results) {
+    ctx->freeResult(x.kind);
+  }
+  for (auto &x : value.results) {
+    ctx->results.push_back(std::move(x));
+  }
+  *ret = value.ret;
+  return true;
+}
+
+void ResultCache::Insert(const std::string &key, const WasmBuffer &ctx,
+                         const int32_t ret) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (store_ == nullptr) {
+    return;
+  }
+  CachedConversion value;
+  value.ret = ret;
+  value.results = ctx.results;
+  store_->Put(key, value);
+}
+
+void ResultCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (store_ != nullptr) {
+    store_->Clear();
+  }
+}
+
+ResultCache &GlobalResultCache() {
+  static ResultCache *cache = new ResultCache();
+  return *cache;
+}
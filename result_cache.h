@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/wasm_buffer.h"
+
+// The outputs and return value of one conversion. The storage of the
+// outputs is shared between the cache and every ctx they are handed to, a
+// hit does not copy it.
+struct CachedConversion {
+  int32_t ret = 0;
+  std::vector<WasmResult> results;
+
+  size_t bytes() const;
+};
+
+// Where ResultCache keeps conversions
+class ResultStore {
+ public:
+  virtual ~ResultStore() = default;
+  virtual bool Get(const std::string &key, CachedConversion *value) = 0;
+  virtual void Put(const std::string &key, const CachedConversion &value) = 0;
+  virtual void Clear() = 0;
+};
+
+// Conversions whose outputs are larger than this are not kept in memory.
+// The cache shares the outputs with the ctx, so a kept conversion pins
+// them in the heap after release_output and free_exporter, and a wasm heap
+// never shrinks.
+const size_t kMaxMemoryCachedBytes = 16 * 1024 * 1024;
+
+// Keeps the most recently used conversions in memory up to a total size
+// of their outputs. Opt-in (result_cache_set_capacity) and not used by the
+// page, the store of the native tools is DirectoryResultStore.
+class MemoryResultStore : public ResultStore {
+ public:
+  explicit MemoryResultStore(size_t capacity,
+                             size_t max_bytes = kMaxMemoryCachedBytes)
+      : capacity_(capacity), max_bytes_(max_bytes) {}
+
+  bool Get(const std::string &key, CachedConversion *value) override;
+  void Put(const std::string &key, const CachedConversion &value) override;
+  void Clear() override;
+
+ private:
+  typedef std::pair<std::string, CachedConversion> Item;
+
+  size_t capacity_;
+  // of one conversion
+  size_t max_bytes_;
+  size_t size_ = 0;
+  // most recently used first
+  std::list<Item> items_;
+  std::unordered_map<std::string, std::list<Item>::iterator> index_;
+};
+
+#ifndef __EMSCRIPTEN__
+// One file per conversion in a directory, so that the cache is shared by
+// every wmc-export process (e.g. the jobs of a batch) and survives them.
+// Files are written to a temporary name and renamed into place, so that
+// concurrent writers of the same key do not corrupt each other.
+class DirectoryResultStore : public ResultStore {
+ public:
+  explicit DirectoryResultStore(std::string dir) : dir_(std::move(dir)) {}
+
+  bool Get(const std::string &key, CachedConversion *value) override;
+  void Put(const std::string &key, const CachedConversion &value) override;
+  void Clear() override;
+
+ private:
+  std::string Path(const std::string &key) const;
+
+  std::string dir_;
+};
+#endif
+
+// A content-addressed cache in front of the exporters: a conversion is
+// identified by the hash of its input bytes and its options, so that
+// converting the same model with the same options again only costs hashing
+// the input. Failed conversions are not cached.
+class ResultCache {
+ public:
+  // nullptr disables the cache
+  void SetStore(std::unique_ptr<ResultStore> store);
+  bool enabled() const { return store_ != nullptr; }
+
+  // target names the exporter, options are everything else that changes
+  // its outputs
+  static std::string Key(const char *target, const void *input, size_t len,
+                         const std::string &options);
+
+  // On a hit, add the cached outputs to ctx and set *ret
+  bool Lookup(const std::string &key, WasmBuffer *ctx, int32_t *ret);
+  // Keep the outputs of ctx, it must not have released any of them yet
+  void Insert(const std::string &key, const WasmBuffer &ctx, int32_t ret);
+  void Clear();
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  std::mutex mutex_;
+  std::unique_ptr<ResultStore> store_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
+// The cache used by the export entry points, disabled until a store is set
+// (result_cache_set_capacity, result_cache_set_dir)
+ResultCache &GlobalResultCache();
@@ -0,0 +1,4 @@
+// The only source of the side modules libwmc_protobuf.wasm and
+// libwmc_onnx.wasm (see cmake/shared_protobuf.cmake). They consist of the
+// whole static libraries they are linked from, a target needs a source
+// file nevertheless.
@@ -0,0 +1,353 @@
+#include "tensor_compare.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+#include "json_string.h"
+
+namespace {
+
+// The partial sums of one pass. Dot products are summed in float within a
+// block and in double across blocks, to stay accurate on large tensors.
+struct Accumulator {
+  size_t violations = 0;
+  size_t nan_mismatches = 0;
+  float max_abs = 0;
+  float max_rel = 0;
+  uint32_t max_ulp = 0;
+  double dot = 0;
+  double norm_a = 0;
+  double norm_b = 0;
+};
+
+const size_t kBlock = 4096;
+
+// floats as integers in the same order, so that the ulp distance is the
+// difference of the integers
+inline int32_t OrderedBits(const float x) {
+  int32_t i;
+  memcpy(&i, &x, sizeof(i));
+  return i ^ ((i >> 31) & 0x7fffffff);
+}
+
+void CompareScalar(const float *a, const float *b, const size_t n,
+                   const Tolerances &tol, Accumulator *acc) {
+  for (size_t start = 0; start < n; start += kBlock) {
+    const size_t end = std::min(n, start + kBlock);
+    float dot = 0, norm_a = 0, norm_b = 0;
+    for (size_t i = start; i < end; i++) {
+      const float x = a[i], y = b[i];
+      const bool nan_x = std::isnan(x), nan_y = std::isnan(y);
+      if (nan_x || nan_y) {
+        acc->nan_mismatches += nan_x != nan_y;
+        continue;
+      }
+      // x == y also covers equal infinities and +0/-0
+      const float d = x == y ? 0.f : std::fabs(x - y);
+      const float abs_y = std::fabs(y);
+      acc->violations += d > static_cast<float>(tol.abs + tol.rel * abs_y);
+      acc->max_abs = std::max(acc->max_abs, d);
+      acc->max_rel = std::max(acc->max_rel, d / std::max(abs_y, FLT_MIN));
+      if (x != y) {
+        const int32_t p = OrderedBits(x), q = OrderedBits(y);
+        const uint32_t ulp = p > q ? static_cast<uint32_t>(p) - q
+                                   : static_cast<uint32_t>(q) - p;
+        acc->max_ulp = std::max(acc->max_ulp, ulp);
+      }
+      dot += x * y;
+      norm_a += x * x;
+      norm_b += y * y;
+    }
+    acc->dot += dot;
+    acc->norm_a += norm_a;
+    acc->norm_b += norm_b;
+  }
+}
+
+#if defined(__SSE2__)
+inline float HorizontalMax(const __m128 v) {
+  float x[4];
+  _mm_storeu_ps(x, v);
+  return std::max(std::max(x[0], x[1]), std::max(x[2], x[3]));
+}
+
+inline float HorizontalSum(const __m128 v) {
+  float x[4];
+  _mm_storeu_ps(x, v);
+  return (x[0] + x[1]) + (x[2] + x[3]);
+}
+
+inline size_t HorizontalCount(const __m128i v) {
+  int32_t x[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(x), v);
+  return static_cast<size_t>(x[0]) + x[1] + x[2] + x[3];
+}
+
+inline __m128i OrderedBits(const __m128 v) {
+  const __m128i i = _mm_castps_si128(v);
+  return _mm_xor_si128(
+      i, _mm_and_si128(_mm_srai_epi32(i, 31), _mm_set1_epi32(0x7fffffff)));
+}
+
+// returns the end of the part compared, the rest is left to CompareScalar
+size_t CompareVector(const float *a, const float *b, const size_t n,
+                     const Tolerances &tol, Accumulator *acc) {
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 abs_tol = _mm_set1_ps(static_cast<float>(tol.abs));
+  const __m128 rel_tol = _mm_set1_ps(static_cast<float>(tol.rel));
+  const __m128 min_norm = _mm_set1_ps(FLT_MIN);
+  // unsigned compares are signed compares with the sign bit flipped
+  const __m128i sign = _mm_set1_epi32(INT32_MIN);
+  __m128 max_abs = _mm_setzero_ps(), max_rel = _mm_setzero_ps();
+  __m128i max_ulp = sign;
+  __m128i violations = _mm_setzero_si128();
+  __m128i nan_mismatches = _mm_setzero_si128();
+  const size_t vector_end = n / 4 * 4;
+  for (size_t start = 0; start < vector_end; start += kBlock) {
+    const size_t end = std::min(vector_end, start + kBlock);
+    __m128 dot = _mm_setzero_ps(), norm_a = _mm_setzero_ps(),
+           norm_b = _mm_setzero_ps();
+    for (size_t i = start; i < end; i += 4) {
+      const __m128 x = _mm_loadu_ps(a + i), y = _mm_loadu_ps(b + i);
+      const __m128 nan_x = _mm_cmpunord_ps(x, x);
+      const __m128 nan_y = _mm_cmpunord_ps(y, y);
+      // all ones where neither is NaN
+      const __m128 valid = _mm_cmpord_ps(x, y);
+      const __m128 equal = _mm_cmpeq_ps(x, y);
+      // comparison masks are -1, subtracting them counts
+      nan_mismatches = _mm_sub_epi32(
+          nan_mismatches, _mm_castps_si128(_mm_xor_ps(nan_x, nan_y)));
+      const __m128 d = _mm_andnot_ps(
+          equal, _mm_and_ps(valid, _mm_and_ps(abs_mask, _mm_sub_ps(x, y))));
+      const __m128 abs_y = _mm_and_ps(abs_mask, y);
+      violations = _mm_sub_epi32(
+          violations,
+          _mm_castps_si128(_mm_cmpgt_ps(
+              d, _mm_add_ps(abs_tol, _mm_mul_ps(rel_tol, abs_y)))));
+      // maxps returns its second operand if either is NaN, so the
+      // maximum so far goes second and survives e.g. inf / inf, like in
+      // CompareScalar
+      max_abs = _mm_max_ps(d, max_abs);
+      max_rel = _mm_max_ps(_mm_div_ps(d, _mm_max_ps(abs_y, min_norm)),
+                           max_rel);
+
+      const __m128i p = OrderedBits(x), q = OrderedBits(y);
+      const __m128i p_greater = _mm_cmpgt_epi32(p, q);
+      const __m128i hi = _mm_or_si128(_mm_and_si128(p_greater, p),
+                                      _mm_andnot_si128(p_greater, q));
+      const __m128i lo = _mm_or_si128(_mm_and_si128(p_greater, q),
+                                      _mm_andnot_si128(p_greater, p));
+      const __m128i ulp = _mm_andnot_si128(
+          _mm_castps_si128(equal),
+          _mm_and_si128(_mm_castps_si128(valid), _mm_sub_epi32(hi, lo)));
+      const __m128i flipped = _mm_xor_si128(ulp, sign);
+      const __m128i ulp_greater = _mm_cmpgt_epi32(flipped, max_ulp);
+      max_ulp = _mm_or_si128(_mm_and_si128(ulp_greater, flipped),
+                             _mm_andnot_si128(ulp_greater, max_ulp));
+
+      const __m128 x_valid = _mm_and_ps(valid, x);
+      const __m128 y_valid = _mm_and_ps(valid, y);
+      dot = _mm_add_ps(dot, _mm_mul_ps(x_valid, y_valid));
+      norm_a = _mm_add_ps(norm_a, _mm_mul_ps(x_valid, x_valid));
+      norm_b = _mm_add_ps(norm_b, _mm_mul_ps(y_valid, y_valid));
+    }
+    acc->dot += HorizontalSum(dot);
+    acc->norm_a += HorizontalSum(norm_a);
+    acc->norm_b += HorizontalSum(norm_b);
+  }
+  acc->max_abs = std::max(acc->max_abs, HorizontalMax(max_abs));
+  acc->max_rel = std::max(acc->max_rel, HorizontalMax(max_rel));
+  uint32_t ulps[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(ulps),
+                   _mm_xor_si128(max_ulp, sign));
+  acc->max_ulp = std::max(acc->max_ulp,
+                          std::max(std::max(ulps[0], ulps[1]),
+                                   std::max(ulps[2], ulps[3])));
+  acc->violations += HorizontalCount(violations);
+  acc->nan_mismatches += HorizontalCount(nan_mismatches);
+  return vector_end;
+}
+#elif defined(__wasm_simd128__)
+inline size_t HorizontalCount(const v128_t v) {
+  return static_cast<size_t>(wasm_i32x4_extract_lane(v, 0)) +
+         wasm_i32x4_extract_lane(v, 1) + wasm_i32x4_extract_lane(v, 2) +
+         wasm_i32x4_extract_lane(v, 3);
+}
+
+inline float HorizontalMax(const v128_t v) {
+  return std::max(
+      std::max(wasm_f32x4_extract_lane(v, 0), wasm_f32x4_extract_lane(v, 1)),
+      std::max(wasm_f32x4_extract_lane(v, 2), wasm_f32x4_extract_lane(v, 3)));
+}
+
+inline float HorizontalSum(const v128_t v) {
+  return (wasm_f32x4_extract_lane(v, 0) + wasm_f32x4_extract_lane(v, 1)) +
+         (wasm_f32x4_extract_lane(v, 2) + wasm_f32x4_extract_lane(v, 3));
+}
+
+inline v128_t OrderedBits(const v128_t v) {
+  return wasm_v128_xor(
+      v, wasm_v128_and(wasm_i32x4_shr(v, 31), wasm_i32x4_splat(0x7fffffff)));
+}
+
+// returns the end of the part compared, the rest is left to CompareScalar
+size_t CompareVector(const float *a, const float *b, const size_t n,
+                     const Tolerances &tol, Accumulator *acc) {
+  const v128_t abs_tol = wasm_f32x4_splat(static_cast<float>(tol.abs));
+  const v128_t rel_tol = wasm_f32x4_splat(static_cast<float>(tol.rel));
+  const v128_t min_norm = wasm_f32x4_splat(FLT_MIN);
+  v128_t max_abs = wasm_f32x4_splat(0), max_rel = wasm_f32x4_splat(0);
+  v128_t max_ulp = wasm_i32x4_splat(0);
+  v128_t violations = wasm_i32x4_splat(0);
+  v128_t nan_mismatches = wasm_i32x4_splat(0);
+  const size_t vector_end = n / 4 * 4;
+  for (size_t start = 0; start < vector_end; start += kBlock) {
+    const size_t end = std::min(vector_end, start + kBlock);
+    v128_t dot = wasm_f32x4_splat(0), norm_a = wasm_f32x4_splat(0),
+           norm_b = wasm_f32x4_splat(0);
+    for (size_t i = start; i < end; i += 4) {
+      const v128_t x = wasm_v128_load(a + i), y = wasm_v128_load(b + i);
+      const v128_t nan_x = wasm_f32x4_ne(x, x);
+      const v128_t nan_y = wasm_f32x4_ne(y, y);
+      const v128_t valid = wasm_v128_not(wasm_v128_or(nan_x, nan_y));
+      const v128_t equal = wasm_f32x4_eq(x, y);
+      nan_mismatches =
+          wasm_i32x4_sub(nan_mismatches, wasm_v128_xor(nan_x, nan_y));
+      const v128_t d = wasm_v128_andnot(
+          wasm_v128_and(valid, wasm_f32x4_abs(wasm_f32x4_sub(x, y))), equal);
+      const v128_t abs_y = wasm_f32x4_abs(y);
+      violations = wasm_i32x4_sub(
+          violations,
+          wasm_f32x4_gt(d, wasm_f32x4_add(abs_tol,
+                                          wasm_f32x4_mul(rel_tol, abs_y))));
+      // pmax returns its first operand if either is NaN, like std::max
+      max_abs = wasm_f32x4_pmax(max_abs, d);
+      max_rel = wasm_f32x4_pmax(
+          max_rel, wasm_f32x4_div(d, wasm_f32x4_pmax(abs_y, min_norm)));
+
+      const v128_t p = OrderedBits(x), q = OrderedBits(y);
+      const v128_t ulp = wasm_v128_andnot(
+          wasm_v128_and(valid, wasm_i32x4_sub(wasm_i32x4_max(p, q),
+                                              wasm_i32x4_min(p, q))),
+          equal);
+      max_ulp = wasm_u32x4_max(max_ulp, ulp);
+
+      const v128_t x_valid = wasm_v128_and(valid, x);
+      const v128_t y_valid = wasm_v128_and(valid, y);
+      dot = wasm_f32x4_add(dot, wasm_f32x4_mul(x_valid, y_valid));
+      norm_a = wasm_f32x4_add(norm_a, wasm_f32x4_mul(x_valid, x_valid));
+      norm_b = wasm_f32x4_add(norm_b, wasm_f32x4_mul(y_valid, y_valid));
+    }
+    acc->dot += HorizontalSum(dot);
+    acc->norm_a += HorizontalSum(norm_a);
+    acc->norm_b += HorizontalSum(norm_b);
+  }
+  acc->max_abs = std::max(acc->max_abs, HorizontalMax(max_abs));
+  acc->max_rel = std::max(acc->max_rel, HorizontalMax(max_rel));
+  // the lane of extract_lane must be a constant
+  const uint32_t ulps[4] = {
+      static_cast<uint32_t>(wasm_i32x4_extract_lane(max_ulp, 0)),
+      static_cast<uint32_t>(wasm_i32x4_extract_lane(max_ulp, 1)),
+      static_cast<uint32_t>(wasm_i32x4_extract_lane(max_ulp, 2)),
+      static_cast<uint32_t>(wasm_i32x4_extract_lane(max_ulp, 3))};
+  acc->max_ulp = std::max(acc->max_ulp,
+                          std::max(std::max(ulps[0], ulps[1]),
+                                   std::max(ulps[2], ulps[3])));
+  acc->violations += HorizontalCount(violations);
+  acc->nan_mismatches += HorizontalCount(nan_mismatches);
+  return vector_end;
+}
+#else
+size_t CompareVector(const float *, const float *, size_t, const Tolerances &,
+                     Accumulator *) {
+  return 0;
+}
+#endif
+
+// json has no inf and nan
+std::string JsonNumber(const double x) {
+  if (!std::isfinite(x)) {
+    return "null";
+  }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", x);
+  return buf;
+}
+
+// the TensorDiff of a finished pass over n elements
+void SetDiff(const Accumulator &acc, const size_t n, TensorDiff *diff) {
+  diff->count = n;
+  diff->violations = acc.violations;
+  diff->nan_mismatches = acc.nan_mismatches;
+  diff->max_abs = acc.max_abs;
+  diff->max_rel = acc.max_rel;
+  diff->max_ulp = acc.max_ulp;
+  if (acc.norm_a == 0 && acc.norm_b == 0) {
+    diff->cosine = 1;
+  } else if (acc.norm_a == 0 || acc.norm_b == 0) {
+    diff->cosine = 0;
+  } else {
+    diff->cosine = acc.dot / std::sqrt(acc.norm_a * acc.norm_b);
+  }
+}
+
+}  // namespace
+
+void CompareFloats(const float *a, const float *b, const size_t n,
+                   const Tolerances &tol, TensorDiff *diff) {
+  Accumulator acc;
+  const size_t done = CompareVector(a, b, n, tol, &acc);
+  CompareScalar(a + done, b + done, n - done, tol, &acc);
+  SetDiff(acc, n, diff);
+}
+
+void CompareFloatsScalar(const float *a, const float *b, const size_t n,
+                         const Tolerances &tol, TensorDiff *diff) {
+  Accumulator acc;
+  CompareScalar(a, b, n, tol, &acc);
+  SetDiff(acc, n, diff);
+}
+
+bool TensorDiff::Passed(const Tolerances &tol) const {
+  return error.empty() && violations == 0 && nan_mismatches == 0 &&
+         (tol.min_cosine == 0 || cosine >= tol.min_cosine) &&
+         (tol.max_ulp == 0 || max_ulp <= tol.max_ulp);
+}
+
+void TensorDiff::Merge(const TensorDiff &other) {
+  count += other.count;
+  violations += other.violations;
+  nan_mismatches += other.nan_mismatches;
+  max_abs = std::max(max_abs, other.max_abs);
+  max_rel = std::max(max_rel, other.max_rel);
+  max_ulp = std::max(max_ulp, other.max_ulp);
+  cosine = std::min(cosine, other.cosine);
+  if (error.empty()) {
+    error = other.error;
+  }
+}
+
+std::string TensorDiff::ToJson() const {
+  char counts[128];
+  snprintf(counts, sizeof(counts),
+           "\"count\": %zu, \"violations\": %zu, \"nan_mismatches\": %zu, ",
+           count, violations, nan_mismatches);
+  std::string res = "{\"name\": " + JsonString(name) + ", " + counts +
+                    "\"max_abs\": " + JsonNumber(max_abs) +
+                    ", \"max_rel\": " + JsonNumber(max_rel) +
+                    ", \"max_ulp\": " + std::to_string(max_ulp) +
+                    ", \"cosine\": " + JsonNumber(cosine);
+  if (!error.empty()) {
+    res += ", \"error\": " + JsonString(error);
+  }
+  return res + "}";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// When an output of the simplified model counts as equal to the original
+// one. An element passes if |a - b| <= abs + rel * |b| like numpy.allclose,
+// min_cosine and max_ulp are ignored if 0.
+struct Tolerances {
+  double abs = 1e-5;
+  double rel = 1e-4;
+  double min_cosine = 0;
+  uint32_t max_ulp = 0;
+};
+
+// How far an output of the simplified model (a) is from the one of the
+// original model (b)
+struct TensorDiff {
+  std::string name;
+  size_t count = 0;
+  // elements outside of the abs/rel tolerance
+  size_t violations = 0;
+  // elements that are NaN in only one of a and b
+  size_t nan_mismatches = 0;
+  double max_abs = 0;
+  double max_rel = 0;
+  uint32_t max_ulp = 0;
+  double cosine = 1;
+  // set if the outputs can not be compared element by element, e.g.
+  // different shapes or an element type without a kernel
+  std::string error;
+
+  bool Passed(const Tolerances &tol) const;
+  // accumulate the diff of another run of the same output
+  void Merge(const TensorDiff &other);
+  std::string ToJson() const;
+};
+
+// Every statistic of TensorDiff in one pass over a and b, with SSE2 on x86,
+// simd128 in wasm builds with WMC_WASM_SIMD and scalar code elsewhere
+void CompareFloats(const float *a, const float *b, size_t n,
+                   const Tolerances &tol, TensorDiff *diff);
+// CompareFloats without the vector code, the reference it is checked
+// against in bench/tensor_compare.cpp
+void CompareFloatsScalar(const float *a, const float *b, size_t n,
+                         const Tolerances &tol, TensorDiff *diff);
@@ -0,0 +1,218 @@
+#include "tools/batch.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "json_string.h"
+#include "tools/work_stealing_pool.h"
+
+namespace {
+
+struct Job {
+  int line;
+  std::vector<std::string> args;
+  // 0 for no limit
+  size_t mem_limit_mb;
+
+  std::string status;
+  int exit_code = -1;
+  int signal = 0;
+  double wall_ms = 0;
+  long peak_rss_kb = 0;
+};
+
+bool ReadManifest(const std::string &path, const size_t default_mem_limit_mb,
+                  std::vector<Job> *jobs) {
+  std::ifstream ifs(path);
+  if (!ifs) {
+    std::cerr << "cannot open " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  for (int line_no = 1; std::getline(ifs, line); line_no++) {
+    std::istringstream iss(line);
+    Job job;
+    job.line = line_no;
+    job.mem_limit_mb = default_mem_limit_mb;
+    std::string arg;
+    while (iss >> arg) {
+      if (arg == "--mem-limit-mb" && iss >> arg) {
+        job.mem_limit_mb = strtoull(arg.c_str(), nullptr, 10);
+      } else {
+        job.args.push_back(arg);
+      }
+    }
+    if (job.args.empty() || job.args[0][0] == '#') {
+      continue;
+    }
+    if (job.args[0] == "batch") {
+      std::cerr << path << ":" << line_no << ": nested batch" << std::endl;
+      return false;
+    }
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+// Run one job as a child process of this executable and wait for it
+void RunJob(Job *job, const std::string &log_dir) {
+  // everything the child needs is prepared before fork, between fork and
+  // exec only async-signal-safe calls are allowed
+  std::vector<std::string> argv_str = {"wmc-export"};
+  argv_str.insert(argv_str.end(), job->args.begin(), job->args.end());
+  std::vector<char *> argv;
+  for (auto &x : argv_str) {
+    argv.push_back(&x[0]);
+  }
+  argv.push_back(nullptr);
+  const std::string log_path =
+      log_dir.empty() ? "" : log_dir + "/job-" + std::to_string(job->line) +
+                                 ".log";
+  struct rlimit limit;
+  limit.rlim_cur = limit.rlim_max =
+      static_cast<rlim_t>(job->mem_limit_mb) * 1024 * 1024;
+
+  const auto start = std::chrono::steady_clock::now();
+  const pid_t pid = fork();
+  if (pid == 0) {
+    if (!log_path.empty()) {
+      const int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0) {
+        dup2(fd, 1);
+        dup2(fd, 2);
+        close(fd);
+      }
+    }
+    if (job->mem_limit_mb > 0) {
+      // not RLIMIT_AS, which counts the mapped model and every reserved
+      // but unused address range as well
+      setrlimit(RLIMIT_DATA, &limit);
+    }
+    execv("/proc/self/exe", argv.data());
+    _exit(127);
+  }
+  if (pid < 0) {
+    job->status = "spawn failed";
+    return;
+  }
+  int status;
+  struct rusage usage;
+  while (wait4(pid, &status, 0, &usage) < 0) {
+    if (errno != EINTR) {
+      job->status = std::string("wait failed: ") + strerror(errno);
+      return;
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  job->wall_ms = std::chrono::duration<double, std::milli>(end - start).count();
+  // kilobytes on linux
+  job->peak_rss_kb = usage.ru_maxrss;
+  if (WIFEXITED(status)) {
+    job->exit_code = WEXITSTATUS(status);
+    job->status = job->exit_code == 0 ? "ok" : "failed";
+  } else if (WIFSIGNALED(status)) {
+    job->signal = WTERMSIG(status);
+    job->status = "killed";
+  }
+}
+
+void WriteSummary(std::ostream &os, const std::vector<Job> &jobs,
+                  const size_t workers, const double wall_ms) {
+  os << "{\n  \"workers\": " << workers << ",\n  \"wall_ms\": " << wall_ms
+     << ",\n  \"jobs\": [";
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const auto &job = jobs[i];
+    std::string command;
+    for (const auto &x : job.args) {
+      command += (command.empty() ? "" : " ") + x;
+    }
+    os << (i == 0 ? "\n" : ",\n") << "    {\"line\": " << job.line
+       << ", \"command\": " << JsonString(command)
+       << ", \"status\": " << JsonString(job.status)
+       << ", \"exit_code\": " << job.exit_code
+       << ", \"signal\": " << job.signal << ", \"wall_ms\": " << job.wall_ms
+       << ", \"peak_rss_kb\": " << job.peak_rss_kb
+       << ", \"mem_limit_mb\": " << job.mem_limit_mb << "}";
+  }
+  os << "\n  ]\n}" << std::endl;
+}
+
+}  // namespace
+
+int RunBatch(const std::vector<std::string> &args) {
+  std::string manifest;
+  std::string summary_path;
+  std::string log_dir;
+  std::string cache_dir;
+  size_t num_workers = std::thread::hardware_concurrency();
+  size_t mem_limit_mb = 0;
+  for (size_t i = 0; i < args.size(); i++) {
+    if (args[i] == "--jobs" && i + 1 < args.size()) {
+      num_workers = strtoull(args[++i].c_str(), nullptr, 10);
+    } else if (args[i] == "--mem-limit-mb" && i + 1 < args.size()) {
+      mem_limit_mb = strtoull(args[++i].c_str(), nullptr, 10);
+    } else if (args[i] == "--summary" && i + 1 < args.size()) {
+      summary_path = args[++i];
+    } else if (args[i] == "--log-dir" && i + 1 < args.size()) {
+      log_dir = args[++i];
+    } else if (args[i] == "--cache-dir" && i + 1 < args.size()) {
+      cache_dir = args[++i];
+    } else if (manifest.empty()) {
+      manifest = args[i];
+    } else {
+      std::cerr << "unknown batch argument " << args[i] << std::endl;
+      return 2;
+    }
+  }
+  std::vector<Job> jobs;
+  if (manifest.empty() || !ReadManifest(manifest, mem_limit_mb, &jobs)) {
+    return 2;
+  }
+  if (!cache_dir.empty()) {
+    for (auto &job : jobs) {
+      job.args.push_back("--cache-dir");
+      job.args.push_back(cache_dir);
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  size_t workers;
+  {
+    WorkStealingPool pool(std::min(num_workers, jobs.size()));
+    workers = pool.size();
+    for (auto &job : jobs) {
+      Job *p = &job;
+      pool.Submit([p, &log_dir]() { RunJob(p, log_dir); });
+    }
+    pool.Wait();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const double wall_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+
+  if (summary_path.empty()) {
+    WriteSummary(std::cout, jobs, workers, wall_ms);
+  } else {
+    std::ofstream ofs(summary_path);
+    WriteSummary(ofs, jobs, workers, wall_ms);
+  }
+  for (const auto &job : jobs) {
+    if (job.status != "ok") {
+      return 1;
+    }
+  }
+  return 0;
+}
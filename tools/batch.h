@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// wmc-export batch <manifest> [--jobs N] [--mem-limit-mb M]
+//                  [--summary summary.json] [--log-dir DIR]
+//                  [--cache-dir DIR]
+//
+// Every non-empty line of the manifest that does not start with '#' is the
+// arguments of one wmc-export command, e.g.
+//   onnxsim models/a.onnx out/a-sim.onnx --input-shape 1,3,224,224
+//   onnx2tnn models/b.onnx out/b --mem-limit-mb 4096
+// Jobs run as child processes of wmc-export on a work-stealing pool of N
+// threads (default: all cores), each under a data limit (RLIMIT_DATA) of M
+// MB, a per-line --mem-limit-mb overrides it. The limit counts the heap and
+// other private writable memory, not the read-only mappings of the model
+// and its external data, so size it like the peak RSS. A JSON summary with
+// the status, wall time and peak RSS of every job is written to the summary
+// file, or to stdout. --cache-dir is passed on to every job, so they share
+// one result cache.
+int RunBatch(const std::vector<std::string> &args);
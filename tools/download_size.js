@@ -0,0 +1,220 @@
+#!/usr/bin/env node
+// Reports the bytes the page downloads for common conversion paths, i.e. the
+// glue code and wasm of every module of web/convert.js a conversion loads
+// plus the side modules those wasm files need (see
+// cmake/shared_protobuf.cmake), each file counted once per path. The wasm
+// files are counted gzipped like upload_ali.sh deploys them, the rest as
+// is. "session" is a visit that runs all paths, where the side modules of a
+// WMC_SHARED_PROTOBUF build are shared between the converters.
+//
+//   node tools/download_size.js --dist <dir of a static build>
+//       [--shared <dir of a WMC_SHARED_PROTOBUF build>] [--json out.json]
+//
+// Both directories hold the deployed files side by side, like the bucket
+// upload_ali.sh uploads to. Paths with files missing are reported as
+// incomplete.
+
+'use strict';
+
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+// The files of the modules of web/module_manager.js, and export.js
+const MODULE_FILES = {
+  onnxsim: ['onnxsim.js', 'onnxsim.wasm'],
+  onnx2ncnn: ['onnx2ncnn.js', 'onnx2ncnn.wasm'],
+  caffe2ncnn: ['caffe2ncnn.js', 'caffe2ncnn.wasm'],
+  ncnnoptimize: ['ncnnoptimize.js', 'ncnnoptimize.wasm'],
+  onnx2ncnn_pipeline: ['onnx2ncnn_pipeline.js', 'onnx2ncnn_pipeline.wasm'],
+  x2mnn: ['MNNConvert.js', 'MNNConvert.wasm'],
+  x2tengine: ['tm_convert_tool.js', 'tm_convert_tool.wasm',
+              'tm_convert_tool.worker.js'],
+  paddle_opt: ['opt.js', 'opt.wasm', 'opt.worker.js'],
+  export: ['export.js', 'export.wasm'],
+};
+
+// The modules of conversion_modules in web/convert.js, with onnxsim and
+// ncnnoptimize enabled
+const PATHS = {
+  'onnx -> ncnn': ['onnxsim', 'onnx2ncnn', 'ncnnoptimize'],
+  'onnx -> ncnn (pipeline)': ['onnx2ncnn_pipeline'],
+  'caffe -> ncnn': ['caffe2ncnn', 'ncnnoptimize'],
+  'onnx -> mnn': ['onnxsim', 'x2mnn'],
+  'caffe -> mnn': ['x2mnn'],
+  'onnx -> tnn': ['export'],
+  'onnx -> tengine': ['onnxsim', 'x2tengine'],
+  'paddle -> paddle-lite': ['paddle_opt'],
+};
+
+const usage = () => {
+  console.error('usage: node tools/download_size.js --dist DIR ' +
+                '[--shared DIR] [--json FILE]');
+  process.exit(2);
+};
+
+const parseArgs = (argv) => {
+  const opts = {};
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '');
+    if (!argv[i].startsWith('--') || i + 1 == argv.length ||
+        !['dist', 'shared', 'json'].includes(key)) {
+      usage();
+    }
+    opts[key] = argv[i + 1];
+  }
+  if (!opts.dist) {
+    usage();
+  }
+  return opts;
+};
+
+// The dynamic libraries a wasm file needs, from its dylink.0 (or the older
+// dylink) custom section. Empty for a statically linked module.
+const neededLibraries = (bytes) => {
+  let pos = 8;
+  const leb = () => {
+    let res = 0;
+    let shift = 0;
+    let b;
+    do {
+      b = bytes[pos++];
+      res += (b & 0x7f) * Math.pow(2, shift);
+      shift += 7;
+    } while (b & 0x80);
+    return res;
+  };
+  const str = () => {
+    const len = leb();
+    pos += len;
+    return bytes.toString('utf8', pos - len, pos);
+  };
+  const strs = () => {
+    const res = [];
+    for (let n = leb(); n > 0; n--) {
+      res.push(str());
+    }
+    return res;
+  };
+  while (pos < bytes.length) {
+    const id = bytes[pos++];
+    const size = leb();
+    const end = pos + size;
+    if (id == 0) {
+      const name = str();
+      if (name == 'dylink.0') {
+        while (pos < end) {
+          const type = bytes[pos++];
+          const sub_end = leb() + pos;
+          // WASM_DYLINK_NEEDED
+          if (type == 2) {
+            return strs();
+          }
+          pos = sub_end;
+        }
+        return [];
+      }
+      if (name == 'dylink') {
+        // memory size and alignment, table size and alignment
+        for (let i = 0; i < 4; i++) {
+          leb();
+        }
+        return strs();
+      }
+    }
+    pos = end;
+  }
+  return [];
+};
+
+// file name -> {raw, download, needed} of the files in dir, read lazily
+const fileSizes = (dir) => {
+  const cache = new Map();
+  return (file) => {
+    if (!cache.has(file)) {
+      const full = path.join(dir, file);
+      if (!fs.existsSync(full)) {
+        cache.set(file, null);
+      } else {
+        const bytes = fs.readFileSync(full);
+        const wasm = file.endsWith('.wasm');
+        cache.set(file, {
+          raw: bytes.length,
+          download: wasm ? zlib.gzipSync(bytes, {level: 9}).length :
+                           bytes.length,
+          // linked by path, deployed by file name
+          needed: wasm ? neededLibraries(bytes).map((x) => path.basename(x)) :
+                         [],
+        });
+      }
+    }
+    return cache.get(file);
+  };
+};
+
+// {files, raw, download, missing} of loading modules from dir
+const measure = (sizes, modules) => {
+  const files = new Set();
+  const missing = [];
+  const add = (file) => {
+    if (files.has(file)) {
+      return;
+    }
+    files.add(file);
+    const size = sizes(file);
+    if (size === null) {
+      missing.push(file);
+      return;
+    }
+    size.needed.forEach(add);
+  };
+  modules.forEach((x) => MODULE_FILES[x].forEach(add));
+  let raw = 0;
+  let download = 0;
+  for (const file of files) {
+    const size = sizes(file);
+    if (size !== null) {
+      raw += size.raw;
+      download += size.download;
+    }
+  }
+  return {files: [...files], raw: raw, download: download, missing: missing};
+};
+
+const mb = (bytes) => (bytes / 1048576).toFixed(2) + 'MB';
+
+const main = () => {
+  const opts = parseArgs(process.argv.slice(2));
+  const builds = {static: fileSizes(opts.dist)};
+  if (opts.shared) {
+    builds.shared = fileSizes(opts.shared);
+  }
+  const paths = Object.assign({}, PATHS, {
+    session: [...new Set([].concat(...Object.values(PATHS)))],
+  });
+  const rows = [];
+  for (const [name, modules] of Object.entries(paths)) {
+    const row = {path: name, modules: modules};
+    for (const build of Object.keys(builds)) {
+      row[build] = measure(builds[build], modules);
+    }
+    rows.push(row);
+    const column = (res) => res.missing.length > 0 ?
+        ('incomplete, no ' + res.missing.join(' ')) :
+        (mb(res.download) + ' (' + mb(res.raw) + ' raw)');
+    let line = name.padEnd(24) + ' ' + column(row.static);
+    if (row.shared !== undefined) {
+      line = line.padEnd(56) + ' -> ' + column(row.shared);
+      if (row.static.missing.length == 0 && row.shared.missing.length == 0) {
+        const change = row.shared.download / row.static.download - 1;
+        line += ' ' + (change > 0 ? '+' : '') + (change * 100).toFixed(1) + '%';
+      }
+    }
+    console.log(line);
+  }
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify(rows, null, 2) + '\n');
+  }
+};
+
+main();
@@ -0,0 +1,392 @@
+#include "tools/model_gen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// splitmix64, fast enough to fill a gigabyte of weights
+class Rng {
+ public:
+  explicit Rng(const uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+  // uniform in [-scale, scale)
+  float Uniform(const float scale) {
+    return (static_cast<float>(Next() >> 40) * (1.0f / (1 << 24)) * 2 - 1) *
+           scale;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+// Adds the nodes, initializers, inputs and outputs of a graph, naming every
+// intermediate value t_<n>
+class GraphBuilder {
+ public:
+  GraphBuilder(onnx::ModelProto *model, const char *name,
+               const ModelGenOptions &options)
+      : graph_(model->mutable_graph()), rng_(options.seed) {
+    model->set_ir_version(6);
+    model->set_producer_name("wmc-gen-model");
+    model->add_opset_import()->set_version(11);
+    graph_->set_name(name);
+  }
+
+  // a dim < 0 is symbolic, named after `dim_params`
+  void Input(const std::string &name, const std::vector<int64_t> &dims,
+             const std::vector<std::string> &dim_params = {}) {
+    AddValueInfo(graph_->add_input(), name, dims, dim_params);
+  }
+  void Output(const std::string &name, const std::vector<int64_t> &dims,
+              const std::vector<std::string> &dim_params = {}) {
+    AddValueInfo(graph_->add_output(), name, dims, dim_params);
+  }
+
+  // float weights uniform in [-scale, scale) plus `offset`
+  std::string Weight(const std::vector<int64_t> &dims, const float scale,
+                     const float offset = 0) {
+    auto *initer = AddInitializer(dims, onnx::TensorProto::FLOAT);
+    size_t numel = 1;
+    for (const auto d : dims) {
+      numel *= d;
+    }
+    std::string raw(numel * sizeof(float), '\0');
+    for (size_t i = 0; i < numel; i++) {
+      const float x = rng_.Uniform(scale) + offset;
+      memcpy(&raw[i * sizeof(float)], &x, sizeof(float));
+    }
+    initer->set_raw_data(std::move(raw));
+    return initer->name();
+  }
+  // He initialization, so that activations neither vanish nor explode in
+  // deep models
+  std::string HeWeight(const std::vector<int64_t> &dims, const int64_t fan_in) {
+    return Weight(dims, std::sqrt(6.0f / fan_in));
+  }
+  std::string Scalar(const float value) {
+    auto *initer = AddInitializer({}, onnx::TensorProto::FLOAT);
+    initer->add_float_data(value);
+    return initer->name();
+  }
+  std::string Int64s(const std::vector<int64_t> &values) {
+    auto *initer = AddInitializer({static_cast<int64_t>(values.size())},
+                                  onnx::TensorProto::INT64);
+    for (const auto x : values) {
+      initer->add_int64_data(x);
+    }
+    return initer->name();
+  }
+  // raw bytes from the generator, for initializers too big for Weight
+  std::string RandomBytes(const std::vector<int64_t> &dims, size_t bytes) {
+    auto *initer = AddInitializer(dims, onnx::TensorProto::FLOAT);
+    std::string raw(bytes, '\0');
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+      // two floats of magnitude in [1, 2), never inf or nan
+      uint64_t x = rng_.Next() & 0x803FFFFF803FFFFFULL;
+      x |= 0x3F8000003F800000ULL;
+      memcpy(&raw[i], &x, 8);
+    }
+    initer->set_raw_data(std::move(raw));
+    return initer->name();
+  }
+
+  onnx::NodeProto *Node(const std::string &op_type,
+                        const std::vector<std::string> &inputs,
+                        std::string *output) {
+    auto *node = graph_->add_node();
+    node->set_name(op_type + "_" + std::to_string(graph_->node_size()));
+    node->set_op_type(op_type);
+    for (const auto &x : inputs) {
+      node->add_input(x);
+    }
+    *output = "t_" + std::to_string(next_value_++);
+    node->add_output(*output);
+    return node;
+  }
+  std::string Op(const std::string &op_type,
+                 const std::vector<std::string> &inputs) {
+    std::string output;
+    Node(op_type, inputs, &output);
+    return output;
+  }
+
+  static void SetInt(onnx::NodeProto *node, const char *name,
+                     const int64_t value) {
+    auto *attr = node->add_attribute();
+    attr->set_name(name);
+    attr->set_type(onnx::AttributeProto::INT);
+    attr->set_i(value);
+  }
+  static void SetInts(onnx::NodeProto *node, const char *name,
+                      const std::vector<int64_t> &values) {
+    auto *attr = node->add_attribute();
+    attr->set_name(name);
+    attr->set_type(onnx::AttributeProto::INTS);
+    for (const auto x : values) {
+      attr->add_ints(x);
+    }
+  }
+  static void SetFloat(onnx::NodeProto *node, const char *name,
+                       const float value) {
+    auto *attr = node->add_attribute();
+    attr->set_name(name);
+    attr->set_type(onnx::AttributeProto::FLOAT);
+    attr->set_f(value);
+  }
+
+  Rng &rng() { return rng_; }
+
+ private:
+  onnx::TensorProto *AddInitializer(const std::vector<int64_t> &dims,
+                                    const int32_t data_type) {
+    auto *initer = graph_->add_initializer();
+    initer->set_name("w_" + std::to_string(graph_->initializer_size()));
+    initer->set_data_type(data_type);
+    for (const auto d : dims) {
+      initer->add_dims(d);
+    }
+    return initer;
+  }
+
+  static void AddValueInfo(onnx::ValueInfoProto *value_info,
+                           const std::string &name,
+                           const std::vector<int64_t> &dims,
+                           const std::vector<std::string> &dim_params) {
+    value_info->set_name(name);
+    auto *tensor = value_info->mutable_type()->mutable_tensor_type();
+    tensor->set_elem_type(onnx::TensorProto::FLOAT);
+    size_t param = 0;
+    for (const auto d : dims) {
+      auto *dim = tensor->mutable_shape()->add_dim();
+      if (d < 0) {
+        dim->set_dim_param(dim_params.at(param++));
+      } else {
+        dim->set_dim_value(d);
+      }
+    }
+  }
+
+  onnx::GraphProto *graph_;
+  Rng rng_;
+  int next_value_ = 0;
+};
+
+std::string ConvBn(GraphBuilder *b, const std::string &x, const int64_t in_c,
+                   const int64_t out_c, const int64_t kernel,
+                   const int64_t stride) {
+  std::string conv;
+  auto *node =
+      b->Node("Conv",
+              {x, b->HeWeight({out_c, in_c, kernel, kernel},
+                              in_c * kernel * kernel)},
+              &conv);
+  GraphBuilder::SetInts(node, "kernel_shape", {kernel, kernel});
+  GraphBuilder::SetInts(node, "strides", {stride, stride});
+  const int64_t pad = kernel / 2;
+  GraphBuilder::SetInts(node, "pads", {pad, pad, pad, pad});
+  std::string bn;
+  node = b->Node("BatchNormalization",
+                 {conv, b->Weight({out_c}, 0.1f, 1), b->Weight({out_c}, 0.1f),
+                  b->Weight({out_c}, 0.1f), b->Weight({out_c}, 0.1f, 1)},
+                 &bn);
+  GraphBuilder::SetFloat(node, "epsilon", 1e-5f);
+  return bn;
+}
+
+std::string LayerNorm(GraphBuilder *b, const std::string &x,
+                      const int64_t hidden) {
+  std::string mean;
+  GraphBuilder::SetInts(b->Node("ReduceMean", {x}, &mean), "axes", {-1});
+  const auto centered = b->Op("Sub", {x, mean});
+  std::string var;
+  GraphBuilder::SetInts(
+      b->Node("ReduceMean", {b->Op("Mul", {centered, centered})}, &var),
+      "axes", {-1});
+  const auto std_dev = b->Op("Sqrt", {b->Op("Add", {var, b->Scalar(1e-5f)})});
+  const auto normalized = b->Op("Div", {centered, std_dev});
+  return b->Op("Add", {b->Op("Mul", {normalized, b->Weight({hidden}, 0.1f, 1)}),
+                       b->Weight({hidden}, 0.1f)});
+}
+
+std::string Linear(GraphBuilder *b, const std::string &x, const int64_t in,
+                   const int64_t out) {
+  return b->Op("Add", {b->Op("MatMul", {x, b->HeWeight({in, out}, in)}),
+                       b->Weight({out}, 0.1f)});
+}
+
+}  // namespace
+
+onnx::ModelProto MakeResNetLike(const int blocks_per_stage, const int width,
+                                const int image_size,
+                                const ModelGenOptions &options) {
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "resnet_like", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  b.Input("input", {batch, 3, image_size, image_size}, {"batch"});
+
+  std::string x = b.Op("Relu", {ConvBn(&b, "input", 3, width, 3, 1)});
+  int64_t channels = width;
+  for (int stage = 0; stage < 4; stage++) {
+    const int64_t out_c = static_cast<int64_t>(width) << stage;
+    for (int i = 0; i < blocks_per_stage; i++) {
+      const int64_t stride = stage > 0 && i == 0 ? 2 : 1;
+      const auto y = b.Op("Relu", {ConvBn(&b, x, channels, out_c, 3, stride)});
+      const auto z = ConvBn(&b, y, out_c, out_c, 3, 1);
+      // a 1x1 projection where the shape of the block changes
+      const auto shortcut = stride != 1 || channels != out_c
+                                ? ConvBn(&b, x, channels, out_c, 1, stride)
+                                : x;
+      x = b.Op("Relu", {b.Op("Add", {z, shortcut})});
+      channels = out_c;
+    }
+  }
+  const auto pooled = b.Op("GlobalAveragePool", {x});
+  std::string flat;
+  GraphBuilder::SetInt(b.Node("Flatten", {pooled}, &flat), "axis", 1);
+  std::string logits;
+  GraphBuilder::SetInt(
+      b.Node("Gemm",
+             {flat, b.HeWeight({1000, channels}, channels),
+              b.Weight({1000}, 0.1f)},
+             &logits),
+      "transB", 1);
+  b.Output(logits, {batch, 1000}, {"batch"});
+  return model;
+}
+
+onnx::ModelProto MakeTransformerLike(const int layers, const int hidden,
+                                     const int heads, const int seq_len,
+                                     const ModelGenOptions &options) {
+  if (heads <= 0 || hidden % heads != 0) {
+    // the heads would not reshape back to the hidden size
+    throw std::invalid_argument("hidden size " + std::to_string(hidden) +
+                                " is not a multiple of " +
+                                std::to_string(heads) + " heads");
+  }
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "transformer_like", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  const int64_t seq = options.dynamic ? -1 : seq_len;
+  b.Input("input", {batch, seq, hidden}, {"batch", "seq"});
+  const int64_t head_dim = hidden / heads;
+
+  std::string x = "input";
+  for (int layer = 0; layer < layers; layer++) {
+    // Reshape copies the dims that are 0, so batch and seq may be symbolic
+    const auto split_shape = b.Int64s({0, 0, heads, head_dim});
+    const auto split = [&](const std::vector<int64_t> &perm) {
+      std::string res;
+      GraphBuilder::SetInts(
+          b.Node("Transpose",
+                 {b.Op("Reshape", {Linear(&b, x, hidden, hidden),
+                                   split_shape})},
+                 &res),
+          "perm", perm);
+      return res;
+    };
+    const auto q = split({0, 2, 1, 3});
+    const auto k = split({0, 2, 3, 1});
+    const auto v = split({0, 2, 1, 3});
+    const auto scores = b.Op(
+        "Div", {b.Op("MatMul", {q, k}),
+                b.Scalar(std::sqrt(static_cast<float>(head_dim)))});
+    std::string probs;
+    GraphBuilder::SetInt(b.Node("Softmax", {scores}, &probs), "axis", 3);
+    std::string merged;
+    GraphBuilder::SetInts(
+        b.Node("Transpose", {b.Op("MatMul", {probs, v})}, &merged), "perm",
+        {0, 2, 1, 3});
+    merged = b.Op("Reshape", {merged, b.Int64s({0, 0, hidden})});
+    x = LayerNorm(&b, b.Op("Add", {x, Linear(&b, merged, hidden, hidden)}),
+                  hidden);
+
+    const auto ffn = Linear(
+        &b, b.Op("Relu", {Linear(&b, x, hidden, 4 * hidden)}), 4 * hidden,
+        hidden);
+    x = LayerNorm(&b, b.Op("Add", {x, ffn}), hidden);
+  }
+  b.Output(x, {batch, seq, hidden}, {"batch", "seq"});
+  return model;
+}
+
+onnx::ModelProto MakeLongChain(const int num_nodes,
+                               const ModelGenOptions &options) {
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "long_chain", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  b.Input("input", {batch, 16}, {"batch"});
+  std::string x = "input";
+  for (int i = 0; i < num_nodes; i++) {
+    // the op mix follows the seed; the scalars keep values near 1
+    switch (b.rng().Next() % 4) {
+      case 0:
+        x = b.Op("Relu", {x});
+        break;
+      case 1:
+        x = b.Op("Add", {x, b.Scalar(b.rng().Uniform(0.01f))});
+        break;
+      case 2:
+        x = b.Op("Mul", {x, b.Scalar(1 + b.rng().Uniform(0.01f))});
+        break;
+      default:
+        x = b.Op("Identity", {x});
+        break;
+    }
+  }
+  b.Output(x, {batch, 16}, {"batch"});
+  return model;
+}
+
+onnx::ModelProto MakeWeightedChain(const int num_nodes,
+                                   const size_t weight_bytes,
+                                   const ModelGenOptions &options) {
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "weighted_chain", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  const int64_t numel = std::max<int64_t>(1, weight_bytes / sizeof(float));
+  b.Input("input", {batch, numel}, {"batch"});
+  std::string x = "input";
+  for (int i = 0; i < num_nodes; i++) {
+    x = b.Op("Add", {x, b.Weight({numel}, 1)});
+  }
+  b.Output(x, {batch, numel}, {"batch"});
+  return model;
+}
+
+onnx::ModelProto MakeHugeInitializer(const size_t bytes,
+                                     const ModelGenOptions &options) {
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "huge_initializer", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  const int64_t rows = 1024;
+  const int64_t cols = std::max<int64_t>(1, bytes / sizeof(float) / rows);
+  b.Input("input", {batch, rows}, {"batch"});
+  const auto weight = b.RandomBytes({rows, cols}, rows * cols * sizeof(float));
+  b.Output(b.Op("MatMul", {"input", weight}), {batch, cols}, {"batch"});
+  return model;
+}
+
+onnx::ModelProto MakeManyInputs(const int num_inputs,
+                                const ModelGenOptions &options) {
+  onnx::ModelProto model;
+  GraphBuilder b(&model, "many_inputs", options);
+  const int64_t batch = options.dynamic ? -1 : 1;
+  std::vector<std::string> inputs;
+  for (int i = 0; i < num_inputs; i++) {
+    inputs.push_back("input_" + std::to_string(i));
+    b.Input(inputs.back(), {batch, 8}, {"batch"});
+  }
+  b.Output(b.Op("Sum", inputs), {batch, 8}, {"batch"});
+  return model;
+}
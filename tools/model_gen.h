@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+
+// Synthetic ONNX models (opset 11) for benchmarks and stress tests of the
+// exporters, so that no model zoo has to be downloaded. The same options
+// and seed give the same model bytes on every platform, weights are drawn
+// from a fixed generator, never from <random> distributions.
+
+struct ModelGenOptions {
+  uint64_t seed = 0;
+  // the batch (and the sequence length of transformer-like models) is a
+  // symbolic dim instead of 1
+  bool dynamic = false;
+};
+
+// A ResNet: conv stem, 4 stages of `blocks_per_stage` basic blocks (conv
+// bn relu conv bn + shortcut) whose channels double from `width`, global
+// average pool and a 1000-way gemm. ResNet-18 is 2 blocks of width 64 on
+// a 224x224 input.
+onnx::ModelProto MakeResNetLike(int blocks_per_stage, int width,
+                                int image_size, const ModelGenOptions &options);
+
+// An encoder of `layers` layers of multi-head self attention and a relu
+// ffn (4 * hidden), each followed by a residual add and a layer norm that
+// is spelled out in ReduceMean/Sub/Div/.. since opset 11 has none.
+// hidden has to be a multiple of heads, throws std::invalid_argument
+// otherwise.
+onnx::ModelProto MakeTransformerLike(int layers, int hidden, int heads,
+                                     int seq_len,
+                                     const ModelGenOptions &options);
+
+// `num_nodes` unary and binary elementwise nodes in a row on a small
+// tensor, every binary one with its own scalar initializer. Deep graphs
+// find the recursive and quadratic passes.
+onnx::ModelProto MakeLongChain(int num_nodes, const ModelGenOptions &options);
+
+// `num_nodes` Add nodes in a row, each adding its own random initializer
+// of `weight_bytes` bytes to a [1, weight_bytes / 4] input. It has as many
+// messages as a real model of the same size, which is what parsing and
+// graph passes scale with, and nothing to deduplicate.
+onnx::ModelProto MakeWeightedChain(int num_nodes, size_t weight_bytes,
+                                   const ModelGenOptions &options);
+
+// A single MatMul by an initializer of about `bytes` bytes, e.g. 1 GB to
+// run into the 2 GB protobuf limit when the model is copied
+onnx::ModelProto MakeHugeInitializer(size_t bytes,
+                                     const ModelGenOptions &options);
+
+// `num_inputs` graph inputs summed up by one Sum node
+onnx::ModelProto MakeManyInputs(int num_inputs,
+                                const ModelGenOptions &options);
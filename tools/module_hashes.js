@@ -0,0 +1,34 @@
+#!/usr/bin/env node
+// Records the sha-256 of wasm files in a json object keyed by file name,
+// which web/module_manager.js uses as the build hash of each converter
+// module. Entries of files not given are kept, so every upload only
+// updates the modules it deploys.
+//
+//   node tools/module_hashes.js web/module_hashes.json onnx2ncnn.wasm ...
+
+'use strict';
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+
+const main = () => {
+  const [output, ...wasm_files] = process.argv.slice(2);
+  if (!output || wasm_files.length == 0) {
+    console.error('usage: node tools/module_hashes.js <output.json> ' +
+                  '<file.wasm>...');
+    process.exit(2);
+  }
+  const hashes = fs.existsSync(output) ?
+      JSON.parse(fs.readFileSync(output, 'utf8')) : {};
+  for (const file of wasm_files) {
+    const hash = crypto.createHash('sha256')
+                     .update(fs.readFileSync(file))
+                     .digest('hex');
+    // 64 bits are plenty to tell builds apart
+    hashes[path.basename(file)] = hash.substring(0, 16);
+  }
+  fs.writeFileSync(output, JSON.stringify(hashes, null, 2) + '\n');
+};
+
+main();
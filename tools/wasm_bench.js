@@ -0,0 +1,309 @@
+#!/usr/bin/env node
+// Runs the emscripten converters of the web page headlessly in node, the
+// way web/convert.js drives them (a fresh module per conversion, inputs
+// written to MEMFS, callMain with the same arguments), and reports per
+// converter and model:
+//   compile_ms      WebAssembly.compile of the .wasm
+//   instantiate_ms  WebAssembly.instantiate with the imports of the module
+//   init_ms         from instantiation to the module being ready
+//   convert_ms      writing the inputs, callMain and reading the outputs
+//   peak_heap_bytes the size of the wasm memory afterwards, which only grows
+//
+//   node tools/wasm_bench.js --dist <dir of the built .js/.wasm>
+//       --corpus tools/wasm_bench_corpus.json --models <dir of the models>
+//       [--repeat 3] [--filter onnx2ncnn] [--json out.json] [--csv out.csv]
+//
+// Nothing is fetched, models missing from --models are reported as
+// skipped. tools/wmc-gen-model writes onnx models for the corpus.
+
+'use strict';
+
+const fs = require('fs');
+const path = require('path');
+const {performance} = require('perf_hooks');
+
+// The converters of web/convert.js: the script and factory of each module
+// and how the arguments of callMain are built from the input files
+const NCNN_OUTPUTS = ['/ncnn.param', '/ncnn.bin'];
+const x2ncnn = (script, factory) => ({
+  script: script,
+  factory: factory,
+  args: (inputs, entry) =>
+      inputs.concat(NCNN_OUTPUTS, entry.extra_args || []),
+  outputs: NCNN_OUTPUTS,
+});
+
+const CONVERTERS = {
+  onnxsim: {
+    script: 'onnxsim.js',
+    factory: 'create_onnxsim',
+    args: (inputs, entry) =>
+        ['-i', inputs[0], '-o', '/sim.onnx'].concat(entry.extra_args || []),
+    outputs: ['/sim.onnx'],
+  },
+  onnx2ncnn: x2ncnn('onnx2ncnn.js', 'create_onnx2ncnn'),
+  caffe2ncnn: x2ncnn('caffe2ncnn.js', 'create_caffe2ncnn'),
+  mxnet2ncnn: x2ncnn('mxnet2ncnn.js', 'create_mxnet2ncnn'),
+  darknet2ncnn: x2ncnn('darknet2ncnn.js', 'create_darknet2ncnn'),
+  ncnnoptimize: x2ncnn('ncnnoptimize.js', 'create_ncnnoptimize'),
+  MNNConvert: {
+    script: 'MNNConvert.js',
+    factory: 'create_x2mnn',
+    args: (inputs, entry) => {
+      const args = ['--bizCode', 'mnn', '-f', entry.format];
+      if (inputs.length == 2) {
+        args.push('--prototxt', inputs[0]);
+      }
+      args.push('--modelFile', inputs[inputs.length - 1]);
+      return args.concat(['--MNNModel', '/tmp/model.mnn'],
+                         entry.extra_args || []);
+    },
+    outputs: ['/tmp/model.mnn'],
+  },
+  tm_convert_tool: {
+    script: 'tm_convert_tool.js',
+    factory: 'create_x2tengine',
+    args: (inputs, entry) => {
+      const args = ['-f', entry.format];
+      if (inputs.length == 2) {
+        args.push('-p', inputs[0]);
+      }
+      args.push('-m', inputs[inputs.length - 1]);
+      return args.concat(['-o', '/tmp/tengine.tmfile'],
+                         entry.extra_args || []);
+    },
+    outputs: ['/tmp/tengine.tmfile'],
+  },
+  opt: {
+    script: 'opt.js',
+    factory: 'create_paddle_opt',
+    args: (inputs, entry) =>
+        ['--model_file', inputs[0], '--param_file', inputs[1],
+         '--optimize_out', '/xxx'].concat(entry.extra_args || []),
+    outputs: ['/xxx.nb'],
+  },
+};
+
+const usage = () => {
+  console.error(
+      'usage: node tools/wasm_bench.js --dist DIR --corpus FILE ' +
+      '--models DIR\n' +
+      '       [--repeat N] [--filter SUBSTR] [--json FILE] [--csv FILE]');
+  process.exit(2);
+};
+
+const parseArgs = (argv) => {
+  const opts = {repeat: 3, filter: ''};
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '');
+    if (!argv[i].startsWith('--') || i + 1 == argv.length ||
+        !['dist', 'corpus', 'models', 'repeat', 'filter', 'json', 'csv']
+             .includes(key)) {
+      usage();
+    }
+    opts[key] = key == 'repeat' ? Math.max(1, parseInt(argv[i + 1])) :
+                                  argv[i + 1];
+  }
+  if (!opts.dist || !opts.corpus || !opts.models) {
+    usage();
+  }
+  return opts;
+};
+
+// The module objects are cached by require, a fresh instance comes from
+// calling the factory again
+const loadFactory = (dist, converter) => {
+  const factory = require(path.resolve(dist, converter.script));
+  if (typeof factory !== 'function') {
+    throw new Error(converter.script + ' does not export ' + converter.factory);
+  }
+  return factory;
+};
+
+// One conversion in a new instance of the module
+const runOnce = async (factory, wasm_bytes, converter, entry, inputs) => {
+  const res = {};
+  let exit_status = 0;
+  const log_lines = [];
+  let instantiated_at = 0;
+  let memory = null;
+  // the factory never settles if instantiateWasm fails
+  let fail;
+  const failed = new Promise((resolve, reject) => {
+    fail = reject;
+  });
+  const module = await Promise.race([failed, factory({
+    noInitialRun: true,
+    print: (text) => log_lines.push(text),
+    printErr: (text) => log_lines.push(text),
+    onExit: (status) => {exit_status = status;},
+    // callMain of a module with EXIT_RUNTIME must not end the harness
+    quit: (status, to_throw) => {
+      exit_status = status;
+      throw to_throw;
+    },
+    // compile and instantiate ourselves to time them apart
+    instantiateWasm: (imports, success_callback) => {
+      (async () => {
+        let start = performance.now();
+        const wasm_module = await WebAssembly.compile(wasm_bytes);
+        res.compile_ms = performance.now() - start;
+        start = performance.now();
+        const instance = await WebAssembly.instantiate(wasm_module, imports);
+        res.instantiate_ms = performance.now() - start;
+        instantiated_at = performance.now();
+        // HEAP8 is not on the module object of newer emscripten
+        memory = instance.exports.memory || (imports.env && imports.env.memory);
+        success_callback(instance, wasm_module);
+      })().catch(fail);
+      return {};
+    },
+  })]);
+  res.init_ms = performance.now() - instantiated_at;
+
+  const start = performance.now();
+  const files = inputs.map((data, i) => {
+    const name = '/input' + i;
+    module.FS.writeFile(name, data);
+    return name;
+  });
+  try {
+    module.callMain(converter.args(files, entry));
+  } catch (e) {
+    if (!(e && e.name == 'ExitStatus')) {
+      exit_status = exit_status || 1;
+      log_lines.push(String(e));
+    }
+  }
+  let output_bytes = 0;
+  if (exit_status == 0) {
+    for (const output of converter.outputs) {
+      try {
+        output_bytes += module.FS.readFile(output).length;
+      } catch (e) {
+        exit_status = 1;
+        log_lines.push('missing output ' + output);
+      }
+    }
+  }
+  res.convert_ms = performance.now() - start;
+  res.peak_heap_bytes = memory ? memory.buffer.byteLength : 0;
+  res.output_bytes = output_bytes;
+  res.exit_status = exit_status;
+  if (exit_status != 0) {
+    res.log = log_lines.slice(-20).join('\n');
+  }
+  return res;
+};
+
+const median = (xs) => {
+  const sorted = xs.slice().sort((a, b) => a - b);
+  return sorted[Math.floor(sorted.length / 2)];
+};
+
+const benchEntry = async (opts, entry) => {
+  const row = {
+    converter: entry.converter,
+    model: entry.name,
+    status: 'ok',
+  };
+  const converter = CONVERTERS[entry.converter];
+  if (!converter) {
+    return Object.assign(row, {status: 'unknown converter'});
+  }
+  const input_paths = entry.inputs.map((x) => path.resolve(opts.models, x));
+  const wasm_path = path.resolve(
+      opts.dist, converter.script.replace(/\.js$/, '.wasm'));
+  const missing = input_paths.concat([wasm_path])
+                      .filter((x) => !fs.existsSync(x));
+  if (missing.length > 0) {
+    return Object.assign(row, {status: 'skipped', missing: missing});
+  }
+
+  const inputs = input_paths.map((x) => new Uint8Array(fs.readFileSync(x)));
+  row.input_bytes = inputs.reduce((sum, x) => sum + x.length, 0);
+  const wasm_bytes = fs.readFileSync(wasm_path);
+  row.wasm_bytes = wasm_bytes.length;
+  const factory = loadFactory(opts.dist, converter);
+  const runs = [];
+  for (let i = 0; i < opts.repeat; i++) {
+    let res;
+    try {
+      res = await runOnce(factory, wasm_bytes, converter, entry, inputs);
+    } catch (e) {
+      return Object.assign(row, {status: 'failed', log: String(e)});
+    }
+    if (res.exit_status != 0) {
+      return Object.assign(row, {status: 'failed'}, res);
+    }
+    runs.push(res);
+  }
+  for (const key of ['compile_ms', 'instantiate_ms', 'init_ms',
+                     'convert_ms']) {
+    row[key] = median(runs.map((x) => x[key]));
+  }
+  row.peak_heap_bytes = Math.max(...runs.map((x) => x.peak_heap_bytes));
+  row.output_bytes = runs[0].output_bytes;
+  row.runs = runs.length;
+  return row;
+};
+
+const CSV_COLUMNS = [
+  'converter', 'model', 'status', 'runs', 'input_bytes', 'wasm_bytes',
+  'compile_ms', 'instantiate_ms', 'init_ms', 'convert_ms', 'peak_heap_bytes',
+  'output_bytes',
+];
+
+const toCsv = (rows) => {
+  const cell = (x) => {
+    if (x === undefined) {
+      return '';
+    }
+    if (typeof x === 'number' && !Number.isInteger(x)) {
+      return x.toFixed(2);
+    }
+    const str = String(x);
+    return /[",\n]/.test(str) ? '"' + str.replace(/"/g, '""') + '"' : str;
+  };
+  return [CSV_COLUMNS.join(',')]
+             .concat(rows.map((r) => CSV_COLUMNS.map((c) => cell(r[c]))
+                                         .join(',')))
+             .join('\n') +
+      '\n';
+};
+
+const main = async () => {
+  const opts = parseArgs(process.argv.slice(2));
+  const corpus = JSON.parse(fs.readFileSync(opts.corpus, 'utf8'));
+  const rows = [];
+  for (const entry of corpus) {
+    const id = entry.converter + '/' + entry.name;
+    if (opts.filter && !id.includes(opts.filter)) {
+      continue;
+    }
+    const row = await benchEntry(opts, entry);
+    rows.push(row);
+    console.log(
+        id.padEnd(40) + ' ' + row.status.padEnd(8) +
+        (row.status == 'ok' ?
+             ' compile ' + row.compile_ms.toFixed(1) + 'ms, instantiate ' +
+                 row.instantiate_ms.toFixed(1) + 'ms, convert ' +
+                 row.convert_ms.toFixed(1) + 'ms, heap ' +
+                 (row.peak_heap_bytes / 1048576).toFixed(1) + 'MB' :
+             ''));
+  }
+  if (opts.json) {
+    fs.writeFileSync(opts.json, JSON.stringify(rows, null, 2) + '\n');
+  }
+  if (opts.csv) {
+    fs.writeFileSync(opts.csv, toCsv(rows));
+  }
+  // a failed conversion fails the run, skipped ones do not
+  process.exitCode = rows.some((r) => r.status == 'failed' ||
+                                      r.status == 'unknown converter') ? 1 : 0;
+};
+
+main().catch((e) => {
+  console.error(e);
+  process.exit(1);
+});
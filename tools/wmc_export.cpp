@@ -0,0 +1,322 @@
+// wmc-export runs the export entry points of export.cpp natively, so that
+// models can be batch-converted on a server and the converter core can be
+// profiled with perf at native speed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "export.h"
+#include "mapped_file.h"
+#include "tensor_compare.h"
+#include "tools/batch.h"
+
+namespace {
+
+const char *kUsage =
+    "usage:\n"
+    "  wmc-export check <model.onnx>\n"
+    "  wmc-export onnxsim <model.onnx> <output.onnx> [--no-opt]\n"
+    "             [--input-shape 1,3,224,224] [--external-data] [--dedupe]\n"
+    "             [--verify off|structural|sampled|full] [--verify-runs N]\n"
+    "             [--verify-budget-ms MS] [--abs-tol X] [--rel-tol X]\n"
+    "             [--min-cosine X] [--max-ulp N]\n"
+    "  wmc-export onnx2tnn <model.onnx> <output prefix>\n"
+    "  wmc-export dedupe <model.onnx> <output.onnx>\n"
+    "  wmc-export batch <manifest> [--jobs N] [--mem-limit-mb M]\n"
+    "             [--summary summary.json] [--log-dir DIR] [--cache-dir DIR]\n"
+    "\n"
+    "  --cache-dir DIR  reuse the outputs of identical earlier conversions\n"
+    "                   kept in DIR\n"
+    "  --trace FILE     write the phases of the conversion as a chrome trace\n"
+    "  --log-level L    debug|info|warning|error, info by default\n";
+
+// Read a file into a new input of ctx, like pushInput in convert.js. Only
+// for onnx2tnn, whose converter may take the input over (see
+// WasmBuffer::detachInput) so it cannot be a mapping, the other commands
+// map their input.
+unsigned char *ReadInput(WasmBuffer *ctx, const std::string &path,
+                         size_t *len) {
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (fp == nullptr) {
+    std::cerr << "cannot open " << path << std::endl;
+    return nullptr;
+  }
+  fseek(fp, 0, SEEK_END);
+  const long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  unsigned char *buf = nullptr;
+  if (size >= 0 && begin_input(ctx, size) != nullptr) {
+    unsigned char *dst = append_input(ctx, size);
+    if (fread(dst, 1, size, fp) == static_cast<size_t>(size)) {
+      buf = end_input(ctx);
+      *len = size;
+    } else {
+      std::cerr << "cannot read " << path << std::endl;
+    }
+  } else {
+    std::cerr << "out of memory when reading " << path << std::endl;
+  }
+  fclose(fp);
+  return buf;
+}
+
+bool WriteResult(WasmBuffer *ctx, const int32_t kind,
+                 const std::string &path) {
+  const auto *res = ctx->findResult(kind);
+  if (res == nullptr) {
+    std::cerr << "the exporter has no output for " << path << std::endl;
+    return false;
+  }
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (fp == nullptr) {
+    std::cerr << "cannot open " << path << std::endl;
+    return false;
+  }
+  const bool ok = fwrite(res->data, 1, res->size, fp) == res->size;
+  fclose(fp);
+  if (!ok) {
+    std::cerr << "cannot write " << path << std::endl;
+  }
+  return ok;
+}
+
+void PrintMessage(WasmBuffer *ctx) {
+  const auto *res = ctx->findResult(kResultMessage);
+  if (res != nullptr && res->size > 0) {
+    std::cerr.write(reinterpret_cast<const char *>(res->data), res->size);
+    std::cerr << std::endl;
+  }
+}
+
+void PrintJson(WasmBuffer *ctx, const int32_t kind) {
+  const auto *res = ctx->findResult(kind);
+  if (res != nullptr) {
+    std::cout.write(reinterpret_cast<const char *>(res->data), res->size);
+    std::cout << std::endl;
+  }
+}
+
+bool ParsePolicy(const std::string &str, int32_t *policy) {
+  // in the order of VerifyPolicy
+  const char *names[] = {"off", "structural", "sampled", "full"};
+  for (int32_t i = 0; i < 4; i++) {
+    if (str == names[i]) {
+      *policy = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseLogLevel(const std::string &str, int32_t *level) {
+  // in the order of LogLevel
+  const char *names[] = {"debug", "info", "warning", "error"};
+  for (int32_t i = 0; i < 4; i++) {
+    if (str == names[i]) {
+      *level = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseShape(const std::string &str, std::vector<int32_t> *shape) {
+  size_t pos = 0;
+  while (pos < str.size()) {
+    char *end;
+    const long dim = strtol(str.c_str() + pos, &end, 10);
+    if (end == str.c_str() + pos || dim <= 0) {
+      return false;
+    }
+    shape->push_back(static_cast<int32_t>(dim));
+    pos = end - str.c_str();
+    if (pos < str.size() && str[pos] != ',') {
+      return false;
+    }
+    pos++;
+  }
+  return !shape->empty();
+}
+
+int Check(WasmBuffer *ctx, const std::vector<std::string> &args) {
+  if (args.size() != 1) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  MappedFile file;
+  if (!file.Open(args[0])) {
+    std::cerr << "cannot open " << args[0] << std::endl;
+    return 1;
+  }
+  // only scanned, the exporter does not take buf over
+  const int ret = check_static_input_size_export(
+      ctx, const_cast<unsigned char *>(file.data()), file.size());
+  PrintMessage(ctx);
+  if (ret == 2) {
+    std::cout << "static" << std::endl;
+  } else if (ret == 1) {
+    std::cout << "dynamic" << std::endl;
+  } else if (ret == -2) {
+    std::cout << "dynamic (multiple inputs)" << std::endl;
+  }
+  return ret < 0 ? 1 : 0;
+}
+
+int OnnxSim(WasmBuffer *ctx, const std::vector<std::string> &args) {
+  std::vector<std::string> paths;
+  bool optimize = true;
+  bool external_data = false;
+  std::vector<int32_t> shape;
+  int32_t verify_policy = kVerifyFull;
+  int32_t verify_runs = 1;
+  double verify_budget_ms = 0;
+  Tolerances tol;
+  for (size_t i = 0; i < args.size(); i++) {
+    if (args[i] == "--no-opt") {
+      optimize = false;
+    } else if (args[i] == "--external-data") {
+      external_data = true;
+    } else if (args[i] == "--dedupe") {
+      exporter_set_dedupe_initializers(ctx, true);
+    } else if (args[i] == "--verify" && i + 1 < args.size()) {
+      if (!ParsePolicy(args[++i], &verify_policy)) {
+        std::cerr << "invalid verification policy " << args[i] << std::endl;
+        return 2;
+      }
+    } else if (args[i] == "--verify-runs" && i + 1 < args.size()) {
+      verify_runs = atoi(args[++i].c_str());
+    } else if (args[i] == "--verify-budget-ms" && i + 1 < args.size()) {
+      verify_budget_ms = atof(args[++i].c_str());
+    } else if (args[i] == "--abs-tol" && i + 1 < args.size()) {
+      tol.abs = atof(args[++i].c_str());
+    } else if (args[i] == "--rel-tol" && i + 1 < args.size()) {
+      tol.rel = atof(args[++i].c_str());
+    } else if (args[i] == "--min-cosine" && i + 1 < args.size()) {
+      tol.min_cosine = atof(args[++i].c_str());
+    } else if (args[i] == "--max-ulp" && i + 1 < args.size()) {
+      tol.max_ulp = strtoul(args[++i].c_str(), nullptr, 10);
+    } else if (args[i] == "--input-shape" && i + 1 < args.size()) {
+      if (!ParseShape(args[++i], &shape)) {
+        std::cerr << "invalid input shape " << args[i] << std::endl;
+        return 2;
+      }
+    } else {
+      paths.push_back(args[i]);
+    }
+  }
+  if (paths.size() != 2) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  exporter_set_verification(ctx, verify_policy, verify_runs,
+                            verify_budget_ms);
+  exporter_set_tolerances(ctx, tol.abs, tol.rel, tol.min_cosine, tol.max_ulp);
+  // mapped instead of read, and may have external data
+  const bool ok =
+      onnxsimplify_file(ctx, paths[0].c_str(), paths[1].c_str(), optimize,
+                        shape.data(), shape.size(), external_data);
+  PrintMessage(ctx);
+  PrintJson(ctx, kResultStats);
+  PrintJson(ctx, kResultVerification);
+  return ok ? 0 : 1;
+}
+
+int Onnx2Tnn(WasmBuffer *ctx, const std::vector<std::string> &args) {
+  if (args.size() != 2) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  size_t len;
+  unsigned char *buf = ReadInput(ctx, args[0], &len);
+  if (buf == nullptr) {
+    return 1;
+  }
+  const bool ok = onnx2tnn_export(ctx, buf, len);
+  PrintMessage(ctx);
+  if (!ok || !WriteResult(ctx, kResultModel, args[1] + ".tnnproto") ||
+      !WriteResult(ctx, kResultWeights, args[1] + ".tnnmodel")) {
+    return 1;
+  }
+  return 0;
+}
+
+int Dedupe(WasmBuffer *ctx, const std::vector<std::string> &args) {
+  if (args.size() != 2) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  const bool ok = onnx_dedupe_file(ctx, args[0].c_str());
+  PrintMessage(ctx);
+  PrintJson(ctx, kResultStats);
+  if (!ok || !WriteResult(ctx, kResultModel, args[1])) {
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  const std::string command = argv[1];
+  std::vector<std::string> args(argv + 2, argv + argc);
+  if (command == "batch") {
+    return RunBatch(args);
+  }
+  std::string trace_path;
+  for (size_t i = 0; i + 1 < args.size();) {
+    if (args[i] == "--cache-dir") {
+      result_cache_set_dir(args[i + 1].c_str());
+    } else if (args[i] == "--trace") {
+      trace_path = args[i + 1];
+    } else if (args[i] == "--log-level") {
+      int32_t level;
+      if (!ParseLogLevel(args[i + 1], &level)) {
+        std::cerr << kUsage;
+        return 2;
+      }
+      exporter_set_log_level(level);
+    } else {
+      i++;
+      continue;
+    }
+    args.erase(args.begin() + i, args.begin() + i + 2);
+  }
+
+  WasmBuffer *ctx = create_exporter();
+  int ret;
+  if (command == "check") {
+    ret = Check(ctx, args);
+  } else if (command == "onnxsim") {
+    ret = OnnxSim(ctx, args);
+  } else if (command == "onnx2tnn") {
+    ret = Onnx2Tnn(ctx, args);
+  } else if (command == "dedupe") {
+    ret = Dedupe(ctx, args);
+  } else {
+    std::cerr << kUsage;
+    ret = 2;
+  }
+  if (!trace_path.empty()) {
+    WriteResult(ctx, kResultTrace, trace_path);
+  }
+  const auto *log = ctx->findResult(kResultLog);
+  if (log != nullptr) {
+    std::cerr.write(reinterpret_cast<const char *>(log->data), log->size);
+  }
+  PrintJson(ctx, kResultTiming);
+  PrintJson(ctx, kResultMemory);
+  free_exporter(ctx);
+  if (result_cache_hits() + result_cache_misses() > 0) {
+    std::cerr << "result cache: " << result_cache_hits() << " hits, "
+              << result_cache_misses() << " misses" << std::endl;
+  }
+  return ret;
+}
@@ -0,0 +1,108 @@
+// wmc-gen-model writes the synthetic models of model_gen.h, to feed the
+// exporters (wmc-export, exporter_bench, the web page) with models of any
+// size without downloading them.
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "external_data.h"
+#include "tools/model_gen.h"
+
+namespace {
+
+const char *kUsage =
+    "usage: wmc-gen-model <kind> <output.onnx> [--seed N] [--dynamic]\n"
+    "                     [--size N] [--width N] [--external-data]\n"
+    "\n"
+    "  resnet       --size blocks per stage (2), --width stem channels (64)\n"
+    "  transformer  --size layers (12), --width hidden size (768), split\n"
+    "               into heads of about 64 that divide it evenly\n"
+    "  chain        --size nodes (100000)\n"
+    "  huge         --size MB of the single initializer (1024)\n"
+    "  inputs       --size inputs (1000)\n"
+    "\n"
+    "  --dynamic        symbolic batch (and sequence) dims\n"
+    "  --external-data  write initializers to <output.onnx>.data, always\n"
+    "                   done for models over the 2 GB protobuf limit\n";
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << kUsage;
+    return 2;
+  }
+  const std::string kind = argv[1];
+  const std::string output = argv[2];
+  ModelGenOptions options;
+  long size = -1;
+  long width = -1;
+  bool external_data = false;
+  for (int i = 3; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--dynamic") {
+      options.dynamic = true;
+    } else if (arg == "--external-data") {
+      external_data = true;
+    } else if (i + 1 < argc && arg == "--seed") {
+      options.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && arg == "--size") {
+      size = std::atol(argv[++i]);
+    } else if (i + 1 < argc && arg == "--width") {
+      width = std::atol(argv[++i]);
+    } else {
+      std::cerr << kUsage;
+      return 2;
+    }
+  }
+
+  onnx::ModelProto model;
+  if (kind == "resnet") {
+    model = MakeResNetLike(size > 0 ? size : 2, width > 0 ? width : 64, 224,
+                           options);
+  } else if (kind == "transformer") {
+    const int hidden = width > 0 ? width : 768;
+    // about 64 per head like BERT, as many heads as divide hidden
+    int heads = std::max(1, hidden / 64);
+    while (hidden % heads != 0) {
+      heads--;
+    }
+    model = MakeTransformerLike(size > 0 ? size : 12, hidden, heads, 128,
+                                options);
+  } else if (kind == "chain") {
+    model = MakeLongChain(size > 0 ? size : 100000, options);
+  } else if (kind == "huge") {
+    model = MakeHugeInitializer((size > 0 ? size : 1024) * 1024 * 1024,
+                                options);
+  } else if (kind == "inputs") {
+    model = MakeManyInputs(size > 0 ? size : 1000, options);
+  } else {
+    std::cerr << kUsage;
+    return 2;
+  }
+
+  const size_t bytes = model.ByteSizeLong();
+  if (external_data || bytes > INT_MAX) {
+    std::string error;
+    // like the onnx python api, small tensors stay in the model
+    if (!SaveWithExternalData(&model, output, 1024, &error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+  } else {
+    std::ofstream ofs(output, std::ios::binary);
+    if (!model.SerializeToOstream(&ofs)) {
+      std::cerr << "cannot write " << output << std::endl;
+      return 1;
+    }
+  }
+  printf("%s: %d nodes, %d initializers, %d inputs, %zu bytes\n",
+         output.c_str(), model.graph().node_size(),
+         model.graph().initializer_size(), model.graph().input_size(), bytes);
+  return 0;
+}
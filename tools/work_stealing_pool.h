@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads, each with its own deque of tasks. A worker
+// takes the newest task from its own deque and, when that is empty, steals
+// the oldest task of another worker, so long jobs do not leave the other
+// workers idle. Tasks must not throw.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(size_t num_workers)
+      : queues_(num_workers == 0 ? 1 : num_workers) {
+    for (size_t i = 0; i < queues_.size(); i++) {
+      queues_[i].reset(new Queue());
+    }
+    for (size_t i = 0; i < queues_.size(); i++) {
+      workers_.emplace_back([this, i]() { Work(i); });
+    }
+  }
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+  ~WorkStealingPool() {
+    Wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &x : workers_) {
+      x.join();
+    }
+  }
+
+  size_t size() const { return queues_.size(); }
+
+  void Submit(std::function<void()> task) {
+    auto &queue = *queues_[next_++ % queues_.size()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_++;
+      pending_++;
+    }
+    cv_.notify_one();
+  }
+
+  // block until every submitted task has finished
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool TryPop(const size_t self, std::function<void()> *task) {
+    {
+      auto &queue = *queues_[self];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        *task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+      }
+    }
+    for (size_t i = 1; i < queues_.size(); i++) {
+      auto &victim = *queues_[(self + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        *task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Work(const size_t self) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+        if (queued_ == 0) {
+          return;
+        }
+        queued_--;
+      }
+      // One queued task is reserved for this worker. It is in some deque,
+      // because tasks are pushed before they are counted.
+      std::function<void()> task;
+      while (!TryPop(self, &task)) {
+        std::this_thread::yield();
+      }
+      task();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--pending_ == 0) {
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> next_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  // submitted tasks not yet taken by a worker
+  size_t queued_ = 0;
+  // submitted tasks not yet finished
+  size_t pending_ = 0;
+  bool stop_ = false;
+};
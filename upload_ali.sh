@@ -9,22 +9,33 @@ cd $DIR
 # ossutil64 --config-file ~/.ossutilconfig cp -u export_gz.wasm  oss://converter-web/export.wasm --meta=Content-Type:application/wasm#Content-Encoding:gzip
 # ossutil64 --config-file ~/.ossutilconfig cp -u export.js oss://converter-web/
 # popd
-function upload_js_wasm {
+function upload_wasm {
   pushd $1
-  js=$2.js
   wasm=$2.wasm
   zipped_wasm=$2_gz.wasm
   gzip -c -9 $wasm > $zipped_wasm
+  # the hash of the deployed wasm keys the module cache of module_manager.js
+  node $DIR/tools/module_hashes.js $DIR/web/module_hashes.json $wasm
   ossutil64 --config-file ~/.ossutilconfig cp -u $zipped_wasm  oss://converter-web/$wasm --meta=Content-Type:application/wasm#Content-Encoding:gzip
-  ossutil64 --config-file ~/.ossutilconfig cp -u $js oss://converter-web/
   popd
 }
+function upload_js_wasm {
+  upload_wasm $1 $2
+  pushd $1
+  ossutil64 --config-file ~/.ossutilconfig cp -u $2.js oss://converter-web/
+  popd
+}
+# the side modules of a WMC_SHARED_PROTOBUF build, upload them with the
+# converters linked against them
+# upload_wasm /home/dev/files/repos/web-model-converter/build-wasm/ libwmc_protobuf
+# upload_wasm /home/dev/files/repos/web-model-converter/build-wasm/ libwmc_onnx
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/ncnn/tools/onnx onnx2ncnn
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/ncnn/tools/caffe caffe2ncnn
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/ncnn/tools/darknet darknet2ncnn
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/ncnn/tools/mxnet mxnet2ncnn
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/ncnn/tools/ ncnnoptimize
 # upload_js_wasm /home/dev/files/repos/web-model-converter/ncnn_wrapper/build/mlir2ncnn/ mlir2ncnn
+# upload_js_wasm /home/dev/files/repos/web-model-converter/build-wasm/ onnx2ncnn_pipeline
 
 # upload_js_wasm /home/dev/files/repos/web-model-converter/tengine_wrapper/build/tengine/tools tm_convert_tool
 # ossutil64 --config-file ~/.ossutilconfig cp -u /home/dev/files/repos/web-model-converter/tengine_wrapper/build/tengine/tools/tm_convert_tool.worker.js oss://converter-web/
@@ -35,6 +46,7 @@ upload_js_wasm /home/dev/files/repos/onnx-simplifier/build-wasm-node-OFF/ onnxsi
 
 pushd ./paddle_wrapper/build/Paddle-Lite/lite/api
 gzip -c -9 opt.wasm > opt_gz.wasm
+node $DIR/tools/module_hashes.js $DIR/web/module_hashes.json opt.wasm
 ossutil64 --config-file ~/.ossutilconfig cp -u opt_gz.wasm  oss://converter-web/opt.wasm --meta=Content-Type:application/wasm#Content-Encoding:gzip
 ossutil64 --config-file ~/.ossutilconfig cp -u opt.js oss://converter-web/
 ossutil64 --config-file ~/.ossutilconfig cp -u opt.worker.js oss://converter-web/
@@ -43,6 +55,11 @@ popd
 pushd web/
 ossutil64 --config-file ~/.ossutilconfig cp -u index.html oss://converter-web/
 ossutil64 --config-file ~/.ossutilconfig cp -u convert.js oss://converter-web/
+ossutil64 --config-file ~/.ossutilconfig cp -u exporter.js oss://converter-web/
+ossutil64 --config-file ~/.ossutilconfig cp -u module_manager.js oss://converter-web/
+ossutil64 --config-file ~/.ossutilconfig cp -u job_runner.js oss://converter-web/
+ossutil64 --config-file ~/.ossutilconfig cp -u convert_worker.js oss://converter-web/
 ossutil64 --config-file ~/.ossutilconfig cp -u ui.js oss://converter-web/
 ossutil64 --config-file ~/.ossutilconfig cp -u robots.txt oss://converter-web/
+ossutil64 --config-file ~/.ossutilconfig cp -u module_hashes.json oss://converter-web/
 popd
@@ -0,0 +1,378 @@
+#include "verify.h"
+
+#include <onnxruntime/cmake/external/onnx/onnx/checker.h>
+#include <onnxruntime/include/onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "graph_index.h"
+#include "json_string.h"
+
+namespace {
+
+const char *PolicyName(const int32_t policy) {
+  switch (policy) {
+    case kVerifyOff:
+      return "off";
+    case kVerifyStructural:
+      return "structural";
+    case kVerifySampled:
+      return "sampled";
+    case kVerifyFull:
+      return "full";
+    default:
+      return "unknown";
+  }
+}
+
+// The real inputs (not initializers) and outputs of a graph with their
+// element types
+std::vector<std::pair<std::string, int>> Interface(
+    const onnx::GraphProto &graph) {
+  const GraphIndex index(graph);
+  std::vector<std::pair<std::string, int>> res;
+  for (const auto &x : graph.input()) {
+    if (!index.IsInitializer(x.name())) {
+      res.emplace_back("input " + x.name(),
+                       x.type().tensor_type().elem_type());
+    }
+  }
+  for (const auto &x : graph.output()) {
+    res.emplace_back("output " + x.name(), x.type().tensor_type().elem_type());
+  }
+  return res;
+}
+
+bool VerifyStructure(const onnx::ModelProto &opt_model,
+                     const onnx::ModelProto &model, std::string *message) {
+  try {
+    onnx::checker::check_model(opt_model);
+  } catch (const std::exception &e) {
+    *message = std::string("onnx checker: ") + e.what();
+    return false;
+  }
+  auto expected = Interface(model.graph());
+  auto actual = Interface(opt_model.graph());
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  if (expected != actual) {
+    *message = "the inputs or outputs of the simplified model differ";
+    return false;
+  }
+  return true;
+}
+
+size_t ElementSize(const int32_t type) {
+  switch (type) {
+    case onnx::TensorProto::UINT8:
+    case onnx::TensorProto::INT8:
+    case onnx::TensorProto::BOOL:
+      return 1;
+    case onnx::TensorProto::UINT16:
+    case onnx::TensorProto::INT16:
+    case onnx::TensorProto::FLOAT16:
+    case onnx::TensorProto::BFLOAT16:
+      return 2;
+    case onnx::TensorProto::FLOAT:
+    case onnx::TensorProto::INT32:
+    case onnx::TensorProto::UINT32:
+      return 4;
+    case onnx::TensorProto::INT64:
+    case onnx::TensorProto::UINT64:
+    case onnx::TensorProto::DOUBLE:
+      return 8;
+    default:
+      // strings and complex numbers
+      return 0;
+  }
+}
+
+// The inputs of one run, like onnxsim: uniform random floats in [0, 1) and
+// zeros for every other type
+struct Feed {
+  std::vector<std::string> names;
+  std::vector<std::vector<unsigned char>> data;
+  std::vector<std::vector<int64_t>> shapes;
+  std::vector<int32_t> types;
+};
+
+void MakeFeed(const onnx::ModelProto &model, const MyTensorShapeMap &input_map,
+              const uint32_t seed, Feed *feed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  const GraphIndex index(model.graph());
+  for (const auto &x : model.graph().input()) {
+    if (index.IsInitializer(x.name())) {
+      continue;
+    }
+    const auto &tensor_type = x.type().tensor_type();
+    std::vector<int64_t> shape;
+    const auto it = input_map.find(x.name());
+    if (it != input_map.end()) {
+      shape = it->second;
+    } else {
+      // dynamic dims are 1
+      for (const auto &dim : tensor_type.shape().dim()) {
+        shape.push_back(dim.dim_value() > 0 ? dim.dim_value() : 1);
+      }
+    }
+    size_t count = 1;
+    for (const auto dim : shape) {
+      count *= dim;
+    }
+    const int32_t type = tensor_type.elem_type();
+    const size_t element_size = ElementSize(type);
+    if (element_size == 0) {
+      throw std::runtime_error("unsupported type of input " + x.name());
+    }
+    std::vector<unsigned char> data(count * element_size);
+    if (type == onnx::TensorProto::FLOAT) {
+      auto *p = reinterpret_cast<float *>(data.data());
+      for (size_t i = 0; i < count; i++) {
+        p[i] = uniform(rng);
+      }
+    } else if (type == onnx::TensorProto::DOUBLE) {
+      auto *p = reinterpret_cast<double *>(data.data());
+      for (size_t i = 0; i < count; i++) {
+        p[i] = uniform(rng);
+      }
+    }
+    feed->names.push_back(x.name());
+    feed->data.push_back(std::move(data));
+    feed->shapes.push_back(std::move(shape));
+    feed->types.push_back(type);
+  }
+}
+
+Ort::Env &OrtEnv() {
+  static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "wmc");
+  return env;
+}
+
+// An onnxruntime session of a model, created once for all runs. Run
+// fetches output_names in their order, so that the sessions of two models
+// whose graphs list their outputs in different orders agree.
+class ModelRunner {
+ public:
+  ModelRunner(const onnx::ModelProto &model,
+              std::vector<std::string> output_names)
+      : output_names_(std::move(output_names)) {
+    std::string bytes;
+    if (!model.SerializeToString(&bytes)) {
+      throw std::runtime_error("serialing ONNX model fails");
+    }
+    Ort::SessionOptions options;
+    options.SetIntraOpNumThreads(1);
+    session_.reset(
+        new Ort::Session(OrtEnv(), bytes.data(), bytes.size(), options));
+  }
+
+  std::vector<Ort::Value> Run(Feed &feed) {
+    const auto memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::vector<Ort::Value> inputs;
+    std::vector<const char *> input_names;
+    for (size_t i = 0; i < feed.names.size(); i++) {
+      inputs.push_back(Ort::Value::CreateTensor(
+          memory_info, feed.data[i].data(), feed.data[i].size(),
+          feed.shapes[i].data(), feed.shapes[i].size(),
+          static_cast<ONNXTensorElementDataType>(feed.types[i])));
+      input_names.push_back(feed.names[i].c_str());
+    }
+    std::vector<const char *> output_names;
+    for (const auto &x : output_names_) {
+      output_names.push_back(x.c_str());
+    }
+    return session_->Run(Ort::RunOptions{nullptr}, input_names.data(),
+                         inputs.data(), inputs.size(), output_names.data(),
+                         output_names.size());
+  }
+
+ private:
+  std::unique_ptr<Ort::Session> session_;
+  std::vector<std::string> output_names_;
+};
+
+TensorDiff CompareOutput(const std::string &name, Ort::Value &a,
+                         Ort::Value &b, const Tolerances &tol) {
+  TensorDiff diff;
+  diff.name = name;
+  const auto info_a = a.GetTensorTypeAndShapeInfo();
+  const auto info_b = b.GetTensorTypeAndShapeInfo();
+  const int32_t type = info_a.GetElementType();
+  if (type != info_b.GetElementType() ||
+      info_a.GetShape() != info_b.GetShape()) {
+    diff.error = "different type or shape";
+    return diff;
+  }
+  const size_t n = info_a.GetElementCount();
+  if (type == onnx::TensorProto::FLOAT) {
+    CompareFloats(a.GetTensorMutableData<float>(),
+                  b.GetTensorMutableData<float>(), n, tol, &diff);
+  } else if (type == onnx::TensorProto::DOUBLE) {
+    // compared in float precision
+    const double *p = a.GetTensorMutableData<double>();
+    const double *q = b.GetTensorMutableData<double>();
+    std::vector<float> x(p, p + n), y(q, q + n);
+    CompareFloats(x.data(), y.data(), n, tol, &diff);
+  } else if (ElementSize(type) > 0) {
+    // integers and bools must be equal, float16 is compared bitwise
+    const size_t size = ElementSize(type);
+    const auto *p = a.GetTensorMutableData<unsigned char>();
+    const auto *q = b.GetTensorMutableData<unsigned char>();
+    diff.count = n;
+    for (size_t i = 0; i < n; i++) {
+      diff.violations += memcmp(p + i * size, q + i * size, size) != 0;
+    }
+  } else {
+    diff.error = "unsupported type";
+  }
+  return diff;
+}
+
+}  // namespace
+
+std::string VerifyReport::Summary() const {
+  std::string res;
+  for (const auto &x : outputs) {
+    if (x.Passed(tolerances)) {
+      continue;
+    }
+    char buf[256];
+    if (!x.error.empty()) {
+      snprintf(buf, sizeof(buf), "output %s: %s", x.name.c_str(),
+               x.error.c_str());
+    } else {
+      snprintf(buf, sizeof(buf),
+               "output %s: %zu of %zu elements out of tolerance, max abs "
+               "error %g, max rel error %g, cosine similarity %.6f",
+               x.name.c_str(), x.violations + x.nan_mismatches, x.count,
+               x.max_abs, x.max_rel, x.cosine);
+    }
+    res += (res.empty() ? "" : "; ") + std::string(buf);
+  }
+  return res;
+}
+
+std::string VerifyReport::ToJson() const {
+  char numbers[192];
+  snprintf(numbers, sizeof(numbers),
+           "\"runs_requested\": %d, \"runs_done\": %d, \"budget_ms\": %.3f, "
+           "\"elapsed_ms\": %.3f, \"session_ms\": %.3f, ",
+           runs_requested, runs_done, budget_ms, elapsed_ms, session_ms);
+  char tols[160];
+  snprintf(tols, sizeof(tols),
+           "{\"abs\": %g, \"rel\": %g, \"min_cosine\": %g, "
+           "\"max_ulp\": %u}",
+           tolerances.abs, tolerances.rel, tolerances.min_cosine,
+           tolerances.max_ulp);
+  std::string outputs_json;
+  for (const auto &x : outputs) {
+    outputs_json += (outputs_json.empty() ? "" : ", ") + x.ToJson();
+  }
+  return std::string("{\"policy\": ") + JsonString(PolicyName(policy)) +
+         ", \"structural\": " + JsonString(structural) +
+         ", \"numerical\": " + JsonString(numerical) + ", " + numbers +
+         "\"budget_exhausted\": " + (budget_exhausted ? "true" : "false") +
+         ", \"message\": " + JsonString(message) + ", \"tolerances\": " +
+         tols + ", \"outputs\": [" + outputs_json + "]}";
+}
+
+bool Verify(const onnx::ModelProto &opt_model, const onnx::ModelProto &model,
+            const MyTensorShapeMap &input_map, const ExportOptions &options,
+            VerifyReport *report) {
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  const auto elapsed_ms = [&start]() {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+  };
+  report->policy = options.verify_policy;
+  if (options.verify_policy == kVerifyOff) {
+    return true;
+  }
+
+  bool ok = VerifyStructure(opt_model, model, &report->message);
+  report->structural = ok ? "passed" : "failed";
+  if (ok && (options.verify_policy == kVerifySampled ||
+             options.verify_policy == kVerifyFull)) {
+    const bool budgeted = options.verify_policy == kVerifySampled &&
+                          options.verify_budget_ms > 0;
+    report->runs_requested = options.verify_runs;
+    report->budget_ms = budgeted ? options.verify_budget_ms : 0;
+    double slowest_run_ms = 0;
+    auto &tol = report->tolerances;
+    tol.abs = options.verify_abs_tol;
+    tol.rel = options.verify_rel_tol;
+    tol.min_cosine = options.verify_min_cosine;
+    tol.max_ulp = options.verify_max_ulp;
+    // VerifyStructure ignores the order of the outputs, both models are
+    // run for the outputs of model in its order
+    std::vector<std::string> output_names;
+    for (const auto &x : model.graph().output()) {
+      output_names.push_back(x.name());
+    }
+    std::unique_ptr<ModelRunner> runner, opt_runner;
+    for (int i = 0; i < options.verify_runs; i++) {
+      double now = elapsed_ms();
+      if (budgeted && now + slowest_run_ms > options.verify_budget_ms) {
+        report->budget_exhausted = true;
+        break;
+      }
+      bool passed = true;
+      try {
+        if (runner == nullptr) {
+          // the sessions are created once, so their time would make the
+          // first run the slowest and stop sampled runs too early
+          runner.reset(new ModelRunner(model, output_names));
+          opt_runner.reset(new ModelRunner(opt_model, output_names));
+          report->session_ms = elapsed_ms() - now;
+          now = elapsed_ms();
+        }
+        Feed feed;
+        MakeFeed(model, input_map, i, &feed);
+        auto outputs = runner->Run(feed);
+        auto opt_outputs = opt_runner->Run(feed);
+        for (size_t j = 0; j < outputs.size(); j++) {
+          auto diff = CompareOutput(output_names[j], opt_outputs[j],
+                                    outputs[j], tol);
+          passed = passed && diff.Passed(tol);
+          if (report->outputs.size() <= j) {
+            report->outputs.push_back(std::move(diff));
+          } else {
+            report->outputs[j].Merge(diff);
+          }
+        }
+      } catch (const std::exception &e) {
+        report->numerical = "error";
+        report->message = std::string("check exception: ") + e.what();
+        ok = false;
+        break;
+      }
+      report->runs_done++;
+      slowest_run_ms = std::max(slowest_run_ms, elapsed_ms() - now);
+      if (!passed) {
+        report->numerical = "failed";
+        report->message = report->Summary();
+        ok = false;
+        break;
+      }
+      report->numerical = "passed";
+    }
+    if (report->runs_done == 0 && report->numerical == "skipped") {
+      report->numerical = "unverified";
+      report->message = report->budget_exhausted
+                            ? "the budget ran out before the first run"
+                            : "no runs were requested";
+    }
+  }
+  report->elapsed_ms = elapsed_ms();
+  return ok;
+}
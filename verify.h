@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <onnxruntime/cmake/external/onnx/onnx/onnx_pb.h>
+#include <onnxruntime/test.h>
+
+#include "common/wasm_buffer.h"
+#include "tensor_compare.h"
+
+// What Verify did, so that a skipped or cut short verification is never
+// mistaken for a passed one
+struct VerifyReport {
+  int32_t policy = kVerifyOff;
+  // "passed", "failed" or "skipped"
+  std::string structural = "skipped";
+  // "passed", "failed", "error", "skipped" if the policy has no runs, or
+  // "unverified" if it has but none was done (verify_runs <= 0 or the
+  // budget ran out before the first one)
+  std::string numerical = "skipped";
+  int runs_requested = 0;
+  int runs_done = 0;
+  double budget_ms = 0;
+  double elapsed_ms = 0;
+  // creating the onnxruntime sessions, not a part of any run
+  double session_ms = 0;
+  // runs were skipped because the next one would not fit in the budget
+  bool budget_exhausted = false;
+  std::string message;
+  Tolerances tolerances;
+  // every output of the model over all runs, in the order of graph.output
+  std::vector<TensorDiff> outputs;
+
+  std::string ToJson() const;
+  // the outputs that are out of tolerance, readable by the user
+  std::string Summary() const;
+};
+
+// Verify opt_model against model according to options.verify_policy. A
+// run feeds both models the same random inputs in onnxruntime and compares
+// all outputs with CompareFloats. Returns false if a verification that was
+// done failed, an unverified model is not a failure. A run that has
+// started is never interrupted, the budget only decides whether the next
+// one starts, estimating its time by the slowest one so far.
+bool Verify(const onnx::ModelProto &opt_model, const onnx::ModelProto &model,
+            const MyTensorShapeMap &input_map, const ExportOptions &options,
+            VerifyReport *report);
@@ -5,101 +5,13 @@ function baseName(str) {
   return base;
 }
 
-function getConvertedModelsAndErrorMsg(mdl, ctx) {
-  let _get_buffer1 = mdl.cwrap('get_buffer1', "number", ["number"])
-  let _get_buffer2 = mdl.cwrap('get_buffer2', "number", ["number"])
-  let _get_buffer3 = mdl.cwrap('get_buffer3', "number", ["number"])
-  let _get_buffer_size1 = mdl.cwrap('get_buffer_size1', "number", ["number"])
-  let _get_buffer_size2 = mdl.cwrap('get_buffer_size2', "number", ["number"])
-  let _get_buffer_size3 = mdl.cwrap('get_buffer_size3', "number", ["number"])
-  bufferOffset1 = _get_buffer1(ctx);
-  bufferSize1 = _get_buffer_size1(ctx);
-  console.log("size1 " + bufferSize1);
-  output1 = new Uint8Array(mdl.HEAP8.subarray(bufferOffset1, bufferOffset1 + bufferSize1));
-  bufferOffset2 = _get_buffer2(ctx);
-  bufferSize2 = _get_buffer_size2(ctx);
-  console.log("size2 " + bufferSize2);
-  output2 = new Uint8Array(mdl.HEAP8.subarray(bufferOffset2, bufferOffset2 + bufferSize2));
-
-  bufferOffset3 = _get_buffer3(ctx);
-  bufferSize3 = _get_buffer_size3(ctx);
-
-  console.log(bufferSize3);
-  output3 = new Uint8Array(mdl.HEAP8.subarray(bufferOffset3, bufferOffset3 + bufferSize3));
-  output3 = String.fromCharCode.apply(null, output3);
-
-  return [output1, output2, output3];
-}
-
-function getErrorMsg(mdl, ctx) {
-  let _get_buffer = mdl.cwrap('get_buffer3', "number", ["number"])
-  let _get_buffer_size = mdl.cwrap('get_buffer_size3', "number", ["number"])
-  bufferOffset = _get_buffer(ctx);
-  bufferSize = _get_buffer_size(ctx);
-  output = new Uint8Array(mdl.HEAP8.subarray(bufferOffset, bufferOffset + bufferSize));
-  const str = String.fromCharCode.apply(null, output);
-
-  return str;
-}
-
-function transferToHeap(mdl, ui8a) {
-  heapSpace = mdl._malloc(ui8a.length *
-    ui8a.BYTES_PER_ELEMENT); // 1
-  mdl.HEAP8.set(ui8a, heapSpace); // 2 
-  return heapSpace;
-}
-
-function transferToHeapInt32(mdl, arr) {
-  heapSpace = mdl._malloc(arr.length *
-    arr.BYTES_PER_ELEMENT); // 1
-  mdl.HEAP32.set(arr, heapSpace / arr.BYTES_PER_ELEMENT); // 2 
-  return heapSpace;
-}
-
-const readFileAsArrayBuffer = (inputFile) => {
-  const temporaryFileReader = new FileReader();
-
-  return new Promise((resolve, reject) => {
-    temporaryFileReader.onerror = () => {
-      temporaryFileReader.abort();
-      reject(new DOMException("Problem parsing input file."));
-    };
-
-    temporaryFileReader.onload = () => {
-      resolve(temporaryFileReader.result);
-    };
-    temporaryFileReader.readAsArrayBuffer(inputFile);
-  });
-};
-
-const cpp_js_wrapper = (mdl, export_name, uint8_arrs, extra_args, extra_types, free = false) => {
-  var ctx = mdl.ccall('create_exporter', 'number');
-  var args = [ctx];
-  var arg_types = ["number"];
-  const n = uint8_arrs.length;
-  for (var i = 0; i < n; i++) {
-    const arr = uint8_arrs[i];
-    const arr_heap = transferToHeap(mdl, arr);
-    args.push(arr_heap, arr.length);
-    arg_types.push("array", "number");
-  }
-  const n2 = extra_args.length;
-  for (var i = 0; i < n2; i++) {
-    args.push(extra_args[i]);
-    arg_types.push(extra_types[i]);
-  }
-  const convert = mdl.cwrap(export_name, arg_types);
-  const success = convert.apply(null, args);
-  if (success) {
-    ret = getConvertedModelsAndErrorMsg(mdl, ctx);
-  } else {
-    ret = getErrorMsg(mdl, ctx);
-  }
-  mdl.ccall('free_exporter', null, ['number'], ctx);
-  return [success, ret];
-}
+// The output lines of a converter are collected in an array and joined once
+// when it is done, appending every line to a string is quadratic on
+// verbose converters.
+const logMessage = (lines) => lines.map((x) => "<br/>" + x).join("");
 
-const files_to_uint8_arrs = async (files) => {
+// Put the files of a two-file format into the order that converters expect
+const order_input_files = (files) => {
   const n = files.length;
   if (n == 2) {
     var swap = false;
@@ -135,106 +47,79 @@ const files_to_uint8_arrs = async (files) => {
       files[1] = tmp;
     }
   }
+  return files;
+}
 
+// Read Files/Blobs into Uint8Arrays, Uint8Arrays are passed through
+const inputs_to_uint8_arrs = async (inputs) => {
   var uint8_arrs = []
-  for (var i = 0; i < n; i++) {
-    const arr = await readFileAsArrayBuffer(files[i]);
-    const arr_ui8a = new Uint8Array(arr);
-    uint8_arrs.push(arr_ui8a);
+  for (var i = 0; i < inputs.length; i++) {
+    if (inputs[i] instanceof Blob) {
+      const arr = await readFileAsArrayBuffer(inputs[i]);
+      uint8_arrs.push(new Uint8Array(arr));
+    } else {
+      uint8_arrs.push(inputs[i]);
+    }
   }
   return uint8_arrs;
 }
 
-const onnxsim_js = async (uint8_arrs, simplify, optimize, infer_shape) => {
+const files_to_uint8_arrs = async (files) => {
+  return inputs_to_uint8_arrs(order_input_files(files));
+}
+
+// Run converter name of module_manager.js in a worker, see
+// JobRunner.runConverter. The Uint8Arrays of inputs are moved to the worker
+// and cannot be used afterwards. Returns [success, ret]: ret is the outputs
+// followed by the log on success, the log otherwise.
+const runConverter = async (name, inputs, args, output_paths, log_filter) => {
   try {
-    exit_status = 0;
-    module = await create_onnxsim(
-      {
-        noInitialRun: true,
-        print: (text) => {console.log(text); msg += ("<br/>" + text);},
-        printErr: (text) => {
-          console.log(text); 
-          msg += ("<br/>" + text);
-        },
-        onExit: (status) => {exit_status = status;}
-      });
-    module['FS'].writeFile('/file1', uint8_arrs[0]);
-    OUTPUT_FILE = '/sim.onnx'
-    args = ['-i', '/file1', '-o', OUTPUT_FILE];
-    if (!simplify) {
-      args.push("--no-sim")
-    }
-    if (!optimize) {
-      args.push("--no-opt")
-    }
-    if (!infer_shape) {
-      args.push("--no-shape-inference")
-    }
-    msg = "";
-    module.callMain(args)
-    success = (exit_status == 0);
-    if (success) {
-      ret = [];
-      ret.push(module['FS'].readFile(OUTPUT_FILE));
-      ret.push(msg);
-    } else {
-      ret = msg;
+    const res = await jobRunner.runConverter(name, inputs, args, output_paths);
+    const lines = log_filter ? res.log.filter(log_filter) : res.log;
+    if (res.exit_status != 0) {
+      return [false, logMessage(lines)];
     }
+    return [true, res.outputs.concat([logMessage(lines)])];
   } catch (e) {
     console.log(e);
-    success = false;
-    ret = e;
+    return [false, e];
   }
+}
 
-  return [success, ret];
+const onnxsim_js = async (uint8_arrs, simplify, optimize, infer_shape) => {
+  const OUTPUT_FILE = '/sim.onnx'
+  let args = ['-i', '/file1', '-o', OUTPUT_FILE];
+  if (!simplify) {
+    args.push("--no-sim")
+  }
+  if (!optimize) {
+    args.push("--no-opt")
+  }
+  if (!infer_shape) {
+    args.push("--no-shape-inference")
+  }
+  return runConverter('onnxsim', [{path: '/file1', data: uint8_arrs[0]}],
+                      args, [OUTPUT_FILE]);
 }
 
-const x2ncnn_js = async (create_module_fn, uint8_arrs, extra_args, opt, fp16) => {
-  try {
-    // mlir2ncnn seems not trigger onExit
-    exit_status = 0;
-    module = await create_module_fn(
-      {
-        noInitialRun: true,
-        print: (text) => {console.log(text); msg += ("<br/>" + text);},
-        printErr: (text) => {
-          console.log(text); 
-          // TODO: move this check to mlir2ncnn itself
-          if (!text.includes("this is a no-op")) {
-            msg += ("<br/>" + text);
-          }
-        },
-        onExit: (status) => {exit_status = status;}
-      });
-    module['FS'].writeFile('/file1', uint8_arrs[0]);
-    args = ['/file1'];
-    if (uint8_arrs.length > 1) {
-      module['FS'].writeFile('/file2', uint8_arrs[1]);
-      args.push('/file2')
-    }
-    NCNN_PARAM = '/ncnn.param';
-    NCNN_BIN = '/ncnn.bin';
-    args.push(NCNN_PARAM, NCNN_BIN);
-    args = args.concat(extra_args);
-    msg = "";
-    module.callMain(args)
-    success = (exit_status == 0);
-    if (success) {
-      ret = [];
-      ret.push(module['FS'].readFile(NCNN_PARAM));
-      ret.push(module['FS'].readFile(NCNN_BIN));
-      if (create_module_fn == create_darknet2ncnn || create_module_fn == create_ncnnoptimize) {
-        ret.push("");     // FIXME: support general log
-      } else {
-        ret.push(msg);
-      }
-    } else {
-      ret = msg;
-    }
-  } catch (e) {
-    console.log(e);
-    success = false;
-    ret = e;
+// module_name is a key of CONVERTER_MODULES in module_manager.js
+const x2ncnn_js = async (module_name, uint8_arrs, extra_args, opt, fp16) => {
+  const inputs = [{path: '/file1', data: uint8_arrs[0]}];
+  let args = ['/file1'];
+  if (uint8_arrs.length > 1) {
+    inputs.push({path: '/file2', data: uint8_arrs[1]});
+    args.push('/file2')
+  }
+  const NCNN_PARAM = '/ncnn.param';
+  const NCNN_BIN = '/ncnn.bin';
+  args.push(NCNN_PARAM, NCNN_BIN);
+  args = args.concat(extra_args);
+  // TODO: move this check to mlir2ncnn itself
+  const log_filter = (text) => !text.includes("this is a no-op");
+  let [success, ret] = await runConverter(module_name, inputs, args,
+                                          [NCNN_PARAM, NCNN_BIN], log_filter);
+  if (success && (module_name == 'darknet2ncnn' || module_name == 'ncnnoptimize')) {
+    ret[2] = "";     // FIXME: support general log
   }
 
   if (!success || !(ret[2] === "")) {
@@ -250,10 +135,33 @@ const x2ncnn_js = async (create_module_fn, uint8_arrs, extra_args, opt, fp16) =>
 
 const ncnnoptimize_js = async (uint8_arrs, fp16) => {
   const fp16_arg = fp16 ? "1" : "0";
-  return x2ncnn_js(create_ncnnoptimize, uint8_arrs, [fp16_arg], false, false);
+  return x2ncnn_js('ncnnoptimize', uint8_arrs, [fp16_arg], false, false);
+}
+
+// Whether onnx2ncnn_pipeline.wasm is deployed, a Promise once it is tried
+var ncnn_pipeline_ready = null;
+
+const ncnn_pipeline_available = () => {
+  if (ncnn_pipeline_ready === null) {
+    ncnn_pipeline_ready = jobRunner.warmUp('onnx2ncnn_pipeline').then(
+        () => true, (e) => {
+          console.log('onnx2ncnn_pipeline is not available: ' + e);
+          return false;
+        });
+  }
+  return ncnn_pipeline_ready;
 }
 
 const onnx2ncnn_js = async (uint8_arrs, onnxsim, ncnnopt, fp16) => {
+  // onnxsim, onnx2ncnn and ncnnoptimize in one module, which parses the
+  // model once and passes it on in memory (see onnx2ncnn_export)
+  if (await ncnn_pipeline_available()) {
+    return jobRunner.runExport('onnx2ncnn_export', uint8_arrs,
+                               [onnxsim, ncnnopt, fp16],
+                               ['boolean', 'boolean', 'boolean'],
+                               'onnx2ncnn_pipeline');
+  }
+
   if (onnxsim) {
     const tmp = await onnxsim_js(uint8_arrs, true, true, true);
     [success, ret] = tmp;
@@ -263,74 +171,46 @@ const onnx2ncnn_js = async (uint8_arrs, onnxsim, ncnnopt, fp16) => {
     uint8_arrs = [ret[0]];
   }
 
-  return x2ncnn_js(create_onnx2ncnn, uint8_arrs, [], ncnnopt, fp16);
+  return x2ncnn_js('onnx2ncnn', uint8_arrs, [], ncnnopt, fp16);
 }
 
 const mlir2ncnn_js = async (uint8_arrs, opt, fp16) => {
-  return x2ncnn_js(create_mlir2ncnn, uint8_arrs, [], opt, fp16);
+  return x2ncnn_js('mlir2ncnn', uint8_arrs, [], opt, fp16);
 }
 
 const darknet2ncnn_js = async (uint8_arrs, merge, opt, fp16) => {
   merge_arg = merge ? 1 : 0;
-  return x2ncnn_js(create_darknet2ncnn, uint8_arrs, [merge_arg], opt, fp16);
+  return x2ncnn_js('darknet2ncnn', uint8_arrs, [merge_arg], opt, fp16);
 }
 
 const caffe2ncnn_js = async (uint8_arrs, opt, fp16) => {
-  return x2ncnn_js(create_caffe2ncnn, uint8_arrs, [], opt, fp16);
+  return x2ncnn_js('caffe2ncnn', uint8_arrs, [], opt, fp16);
 }
 
 const mxnet2ncnn_js = async (uint8_arrs, opt, fp16) => {
-  return x2ncnn_js(create_mxnet2ncnn, uint8_arrs, [], opt, fp16);
+  return x2ncnn_js('mxnet2ncnn', uint8_arrs, [], opt, fp16);
 }
 
 const x2mnn_js = async (src_format, uint8_arrs, extra_args) => {
-  try {
-    exit_status = 0;
-    module = await create_x2mnn(
-      {
-        noInitialRun: true,
-        print: (text) => {console.log(text); msg += ("<br/>" + text);},
-        printErr: (text) => {
-          console.log(text); 
-          msg += ("<br/>" + text);
-        },
-        onExit: (status) => {exit_status = status;}
-      });
-    args = ['--bizCode', 'mnn', '-f', src_format];
-    module['FS'].writeFile('/file_one', uint8_arrs[0]);
-    if (uint8_arrs.length == 1) {
-      args.push('--modelFile')
-      args.push('/file_one')
-    } else if (uint8_arrs.length == 2) {
-      args.push('--prototxt')
-      args.push('/file_one')
-      module['FS'].writeFile('/file_two', uint8_arrs[1]);
-      args.push('--modelFile')
-      args.push('/file_two')
-    } else {
-      // TODO: raise exception
-    }
-    OUTPUT_FILE = '/tmp/model.mnn';
-    args.push('--MNNModel');
-    args.push(OUTPUT_FILE);
-    args = args.concat(extra_args);
-    msg = "";
-    module.callMain(args)
-    success = (exit_status == 0);
-    if (success) {
-      ret = [];
-      ret.push(module['FS'].readFile(OUTPUT_FILE));
-      ret.push(msg);
-    } else {
-      ret = msg;
-    }
-  } catch (e) {
-    console.log(e);
-    success = false;
-    ret = e;
+  let args = ['--bizCode', 'mnn', '-f', src_format];
+  const inputs = [{path: '/file_one', data: uint8_arrs[0]}];
+  if (uint8_arrs.length == 1) {
+    args.push('--modelFile')
+    args.push('/file_one')
+  } else if (uint8_arrs.length == 2) {
+    args.push('--prototxt')
+    args.push('/file_one')
+    inputs.push({path: '/file_two', data: uint8_arrs[1]});
+    args.push('--modelFile')
+    args.push('/file_two')
+  } else {
+    // TODO: raise exception
   }
-
-  return [success, ret];
+  const OUTPUT_FILE = '/tmp/model.mnn';
+  args.push('--MNNModel');
+  args.push(OUTPUT_FILE);
+  args = args.concat(extra_args);
+  return runConverter('x2mnn', inputs, args, [OUTPUT_FILE]);
 }
 
 const caffe2mnn_js = async (uint8_arrs) => {
@@ -338,8 +218,6 @@ const caffe2mnn_js = async (uint8_arrs) => {
 }
 
 const onnx2mnn_js = async (uint8_arrs, sim) => {
-  mdl = Module;
-
   if (sim) {
     const tmp = await onnxsim_js(uint8_arrs, true, true, true);
     [success, ret] = tmp;
@@ -361,58 +239,28 @@ const tflite2mnn_js = async (uint8_arrs) => {
 }
 
 const x2tengine_js = async (src_format, uint8_arrs, extra_args) => {
-  try {
-    exit_status = 0;
-    module = await create_x2tengine(
-      {
-        noInitialRun: true,
-        print: (text) => {console.log(text); msg += ("<br/>" + text);},
-        printErr: (text) => {
-          console.log(text); 
-          msg += ("<br/>" + text);
-        },
-        onExit: (status) => {exit_status = status;}
-      });
-    args = ['-f', src_format];
-    module['FS'].writeFile('/file1', uint8_arrs[0]);
-    if (uint8_arrs.length == 1) {
-      args.push('-m')
-      args.push('/file1')
-    } else if (uint8_arrs.length == 2) {
-      args.push('-p')
-      args.push('/file1')
-      module['FS'].writeFile('/file2', uint8_arrs[1]);
-      args.push('-m')
-      args.push('/file2')
-    } else {
-      // TODO: raise exception
-    }
-    TMFILE = '/tmp/tengine.tmfile';
-    args.push('-o');
-    args.push(TMFILE);
-    args = args.concat(extra_args);
-    msg = "";
-    module.callMain(args)
-    success = (exit_status == 0);
-    if (success) {
-      ret = [];
-      ret.push(module['FS'].readFile(TMFILE));
-      ret.push(msg);
-    } else {
-      ret = msg;
-    }
-  } catch (e) {
-    console.log(e);
-    success = false;
-    ret = e;
+  let args = ['-f', src_format];
+  const inputs = [{path: '/file1', data: uint8_arrs[0]}];
+  if (uint8_arrs.length == 1) {
+    args.push('-m')
+    args.push('/file1')
+  } else if (uint8_arrs.length == 2) {
+    args.push('-p')
+    args.push('/file1')
+    inputs.push({path: '/file2', data: uint8_arrs[1]});
+    args.push('-m')
+    args.push('/file2')
+  } else {
+    // TODO: raise exception
   }
-
-  return [success, ret];
+  const TMFILE = '/tmp/tengine.tmfile';
+  args.push('-o');
+  args.push(TMFILE);
+  args = args.concat(extra_args);
+  return runConverter('x2tengine', inputs, args, [TMFILE]);
 }
 
 const onnx2tengine_js = async (uint8_arrs, sim) => {
-  mdl = Module;
-
   if (sim) {
     const tmp = await onnxsim_js(uint8_arrs, true, true, true);
     [success, ret] = tmp;
@@ -449,19 +297,22 @@ const ncnn2tengine_js = async (uint8_arrs) => {
   return x2tengine_js("ncnn", uint8_arrs, []);
 }
 
-const onnx2tnn_js = async (uint8_arrs, onnxsim) => {
-  mdl = Module;
-
+// inputs are Files or Uint8Arrays, files are streamed into the exporter.
+// onnxsim is the onnxsimplify_export of the same module rather than the
+// onnxsim tool, which needs the whole model in js for its file system.
+const onnx2tnn_js = async (inputs, onnxsim) => {
   if (onnxsim) {
-    const tmp = await onnxsim_js(uint8_arrs, true, true, true);
+    const tmp = await jobRunner.runExport('onnxsimplify_export', inputs,
+                                          [true, 0, 0],
+                                          ['boolean', 'number', 'number']);
     [success, ret] = tmp;
     if (!success) {
       return tmp;
     }
-    uint8_arrs = [ret[0]];
+    inputs = [ret[0]];
   }
 
-  tmp = cpp_js_wrapper(mdl, 'onnx2tnn_export', uint8_arrs, [], []);
+  tmp = await jobRunner.runExport('onnx2tnn_export', inputs, [], []);
   [success, ret] = tmp;
   if (!success || !(ret[2] === "")) {
     return tmp;
@@ -470,52 +321,65 @@ const onnx2tnn_js = async (uint8_arrs, onnxsim) => {
   return [success, ret];
 }
 
-const check_onnx_static_input_shape_js = (uint8_arrs) => {
-  mdl = Module;
+const check_onnx_static_input_shape_js = async (inputs) => {
   const export_name = 'check_static_input_size_export';
-  return cpp_js_wrapper(mdl, export_name, uint8_arrs, [], []);
+  return jobRunner.runExport(export_name, inputs, [], []);
 }
 
 const paddle_js = async (uint8_arrs) => {
-  try {
-    exit_status = 0;
-    module = await create_paddle_opt(
-      {
-        noInitialRun: true,
-        print: (text) => {console.log(text); msg += ("<br/>" + text);},
-        printErr: (text) => {
-          console.log(text); 
-          msg += ("<br/>" + text);
-        },
-        onExit: (status) => {exit_status = status;}
-      });
-    module['FS'].writeFile('/file1', uint8_arrs[0]);
-    module['FS'].writeFile('/file2', uint8_arrs[1]);
-    OUTPUT_FILE = '/xxx'
-    args = ['--model_file', '/file1', '--param_file', '/file2', '--optimize_out', OUTPUT_FILE];
-    msg = "";
-    module.callMain(args)
-    success = (exit_status == 0);
-    if (success) {
-      ret = [];
-      ret.push(module['FS'].readFile(OUTPUT_FILE + '.nb'));
-      ret.push(msg);
-    } else {
-      ret = msg;
+  const inputs = [{path: '/file1', data: uint8_arrs[0]},
+            {path: '/file2', data: uint8_arrs[1]}];
+  const OUTPUT_FILE = '/xxx'
+  let args = ['--model_file', '/file1', '--param_file', '/file2', '--optimize_out', OUTPUT_FILE];
+  return runConverter('paddle_opt', inputs, args, [OUTPUT_FILE + '.nb']);
+}
+
+// The modules of module_manager.js (and 'export' for export.js) that a
+// conversion runs, in order, as the *_js functions above run them
+const conversion_modules = async (output, input, onnxsim, ncnnopt) => {
+  // the exporter simplifies for tnn itself, see onnx2tnn_js
+  const sim = onnxsim && input == 'onnx' && output != 'tnn' ? ['onnxsim'] : [];
+  if (output == 'ncnn') {
+    if (input == 'onnx' && await ncnn_pipeline_available()) {
+      return ['onnx2ncnn_pipeline'];
     }
-  } catch (e) {
-    console.log(e);
-    success = false;
-    ret = e;
+    const opt = ncnnopt ? ['ncnnoptimize'] : [];
+    return input == 'ncnn' ? ['ncnnoptimize'] :
+                             sim.concat([input + '2ncnn'], opt);
+  }
+  const modules = {
+    'mnn': ['x2mnn'],
+    'tengine': ['x2tengine'],
+    'tnn': ['export'],
+    'paddle-lite': ['paddle_opt'],
+    'onnx': [],
+  }[output];
+  return output == 'onnx' ? ['onnxsim'] : sim.concat(modules || []);
+}
+
+// Load the modules of a conversion when its formats are selected, instead
+// of every module when the page is loaded. Resolves when the first one is
+// ready, the ones after it are prefetched meanwhile.
+const prepare_conversion = async (output, input, onnxsim, ncnnopt) => {
+  const modules = await conversion_modules(output, input, onnxsim, ncnnopt);
+  const ready = modules.map((x) => jobRunner.warmUp(x));
+  // a failed prefetch is tried again by the conversion itself
+  ready.slice(1).forEach((x) => x.catch((e) => console.log(e)));
+  if (ready.length > 0) {
+    await ready[0];
   }
-
-  return [success, ret];
 }
 
 //
 // create object url
 //
 function createObjectURL(array, type) {
+  // outputs of the exporters are already blobs, see readResultAsBlob
+  if (array instanceof Blob) {
+    var url = window.URL || window.webkitURL;
+    return url.createObjectURL(array);
+  }
+
   var useTypedArray = (typeof Uint8Array !== 'undefined');
   var isSafari = (
     navigator.userAgent.indexOf('Safari') !== -1 &&
@@ -573,8 +437,3 @@ function createObjectURL(array, type) {
 
   return 'data:' + type + ';base64,' + window.btoa(data);
 }
-
-createOnnxOpt(/* optional default settings */).then(function (Module) {
-  // this is reached when everything is ready, and you can call methods on Module
-  oom = Module;
-});
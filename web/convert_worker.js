@@ -0,0 +1,97 @@
+// The worker side of job_runner.js. A worker hosts one module, either a
+// converter of module_manager.js or the exporters of export.js, and runs
+// one job of it at a time:
+//   {type: 'load', module}
+//       load the module ahead of the first job
+//   {type: 'main', module, inputs: [{path, data}], args, outputs}
+//       see ModuleManager.run
+//   {type: 'export', module, export_name, inputs, extra_args, extra_types}
+//       see cpp_js_wrapper, module is 'export' or an exporter module of
+//       module_manager.js
+// and posts back {result} or {error}. The output buffers of converters are
+// transferred to the page; the outputs of the exporters are Blobs, which are
+// passed by reference anyway.
+
+importScripts('exporter.js', 'module_manager.js');
+
+// module name -> Promise of the module
+const exporters = new Map();
+
+// export.js is not modularized, it picks up the Module defined before it.
+// The other exporter modules are instantiated once like the converters.
+const loadExporter = (name) => {
+  if (!exporters.has(name)) {
+    if (name == 'export') {
+      exporters.set(name, new Promise((resolve) => {
+        self.Module = {
+          onRuntimeInitialized: () => resolve(self.Module),
+          // see ModuleManager.instantiate
+          locateFile: (path, prefix) => prefix + path.split('/').pop(),
+        };
+        importScripts('export.js');
+      }));
+    } else {
+      const loading = moduleManager.instantiate(name)
+                          .then((entry) => entry.module);
+      exporters.set(name, loading);
+      loading.catch(() => exporters.delete(name));
+    }
+  }
+  return exporters.get(name);
+};
+
+const loadConverter = (name) => {
+  if (CONVERTER_MODULES[name] === undefined) {
+    throw new Error('unknown converter ' + name);
+  }
+  return moduleManager.load(name);
+};
+
+// the buffer of a typed array that views all of it can be moved instead of
+// copied
+const ownBuffer = (arr) => {
+  if (arr.byteOffset == 0 && arr.byteLength == arr.buffer.byteLength) {
+    return arr;
+  }
+  return arr.slice();
+};
+
+// job -> [result, transfer list]
+const handlers = {
+  // resolves to {module, source, compile_ms}, see ModuleManager.load
+  load: async (job) => {
+    if (job.module == 'export') {
+      await loadExporter(job.module);
+      return [{module: job.module, source: 'glue'}, []];
+    }
+    const res = await loadConverter(job.module);
+    if (CONVERTER_MODULES[job.module].exporter) {
+      await loadExporter(job.module);
+    }
+    return [res, []];
+  },
+  main: async (job) => {
+    await loadConverter(job.module);
+    const res = await moduleManager.run(job.module, job.inputs, job.args,
+                                        job.outputs);
+    res.outputs = res.outputs.map(ownBuffer);
+    return [res, res.outputs.map((x) => x.buffer)];
+  },
+  export: async (job) => {
+    const mdl = await loadExporter(job.module);
+    const ret = await cpp_js_wrapper(mdl, job.export_name, job.inputs,
+                                     job.extra_args, job.extra_types);
+    return [ret, []];
+  },
+};
+
+self.onmessage = async (e) => {
+  const job = e.data;
+  try {
+    const [result, transfer] = await handlers[job.type](job);
+    self.postMessage({result: result}, transfer);
+  } catch (err) {
+    console.log(err);
+    self.postMessage({error: String(err)});
+  }
+};
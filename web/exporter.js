@@ -0,0 +1,190 @@
+// The js side of the exporter api of export.cpp (export.h): streaming
+// inputs into a ctx and reading its results. Loaded by the page and by
+// convert_worker.js, which runs the exporters off the main thread.
+
+// Keep in sync with WasmResultKind in common/wasm_buffer.h
+const RESULT_MODEL = 0;
+const RESULT_WEIGHTS = 1;
+const RESULT_MESSAGE = 2;
+const RESULT_STATS = 3;
+const RESULT_VERIFICATION = 4;
+const RESULT_TIMING = 5;
+const RESULT_TRACE = 6;
+const RESULT_MEMORY = 7;
+const RESULT_LOG = 8;
+
+// Outputs are copied out of the wasm heap in pieces of this size
+const OUTPUT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Move the i-th output of ctx into a Blob chunk by chunk, and free the wasm
+// copy of it afterwards. Every chunk is copied from a view of the heap into
+// a Blob of its own, so js never holds the output as arrays, and the
+// browser may keep the Blobs out of the js heap (e.g. on disk). Wasm memory
+// never shrinks, so releasing the wasm copy chunk by chunk would not lower
+// the peak, it returns the copy to malloc for the next conversion. The heap
+// is re-read for every chunk because it is replaced when the wasm memory
+// grows.
+function readResultAsBlob(mdl, ctx, i) {
+  let _result_ptr = mdl.cwrap('result_ptr', "number", ["number", "number"])
+  let _result_size = mdl.cwrap('result_size', "number", ["number", "number"])
+  let _release_output = mdl.cwrap('release_output', null, ["number", "number"])
+  const offset = _result_ptr(ctx, i);
+  const size = _result_size(ctx, i);
+  var parts = [];
+  for (var pos = 0; pos < size; pos += OUTPUT_CHUNK_SIZE) {
+    const end = Math.min(pos + OUTPUT_CHUNK_SIZE, size);
+    parts.push(new Blob([mdl.HEAPU8.subarray(offset + pos, offset + end)]));
+  }
+  _release_output(ctx, i);
+  // a Blob of Blobs refers to them instead of copying
+  return new Blob(parts);
+}
+
+function readResultAsString(mdl, ctx, i) {
+  let _result_ptr = mdl.cwrap('result_ptr', "number", ["number", "number"])
+  let _result_size = mdl.cwrap('result_size', "number", ["number", "number"])
+  const offset = _result_ptr(ctx, i);
+  const size = _result_size(ctx, i);
+  var str = "";
+  for (var pos = 0; pos < size; pos += 0x7fff) {
+    const end = Math.min(pos + 0x7fff, size);
+    str += String.fromCharCode.apply(null, mdl.HEAPU8.subarray(offset + pos, offset + end));
+  }
+  return str;
+}
+
+// Returns [{kind, data}], data is a Blob for models and a string for messages
+function getResults(mdl, ctx) {
+  let _result_count = mdl.cwrap('result_count', "number", ["number"])
+  let _result_kind = mdl.cwrap('result_kind', "number", ["number", "number"])
+  const n = _result_count(ctx);
+  var results = [];
+  for (var i = 0; i < n; i++) {
+    const kind = _result_kind(ctx, i);
+    if (kind == RESULT_MESSAGE || kind == RESULT_STATS ||
+        kind == RESULT_VERIFICATION || kind == RESULT_TIMING ||
+        kind == RESULT_TRACE || kind == RESULT_MEMORY || kind == RESULT_LOG) {
+      results.push({kind: kind, data: readResultAsString(mdl, ctx, i)});
+    } else {
+      results.push({kind: kind, data: readResultAsBlob(mdl, ctx, i)});
+    }
+  }
+  return results;
+}
+
+function getConvertedModelsAndErrorMsg(mdl, ctx) {
+  var output1 = new Blob([]);
+  var output2 = new Blob([]);
+  var output3 = "";
+  for (const res of getResults(mdl, ctx)) {
+    if (res.kind == RESULT_MODEL) {
+      output1 = res.data;
+    } else if (res.kind == RESULT_WEIGHTS) {
+      output2 = res.data;
+    } else if (res.kind == RESULT_MESSAGE) {
+      output3 = res.data;
+    } else if (res.kind == RESULT_STATS || res.kind == RESULT_VERIFICATION ||
+               res.kind == RESULT_TIMING || res.kind == RESULT_MEMORY ||
+               res.kind == RESULT_LOG) {
+      console.log(res.data);
+    }
+  }
+
+  return [output1, output2, output3];
+}
+
+function getErrorMsg(mdl, ctx) {
+  let _result_count = mdl.cwrap('result_count', "number", ["number"])
+  let _result_kind = mdl.cwrap('result_kind', "number", ["number", "number"])
+  const n = _result_count(ctx);
+  for (var i = 0; i < n; i++) {
+    if (_result_kind(ctx, i) == RESULT_MESSAGE) {
+      return readResultAsString(mdl, ctx, i);
+    }
+  }
+  return "";
+}
+
+function transferToHeapInt32(mdl, arr) {
+  heapSpace = mdl._malloc(arr.length *
+    arr.BYTES_PER_ELEMENT); // 1
+  mdl.HEAP32.set(arr, heapSpace / arr.BYTES_PER_ELEMENT); // 2 
+  return heapSpace;
+}
+
+const readFileAsArrayBuffer = (inputFile) => {
+  const temporaryFileReader = new FileReader();
+
+  return new Promise((resolve, reject) => {
+    temporaryFileReader.onerror = () => {
+      temporaryFileReader.abort();
+      reject(new DOMException("Problem parsing input file."));
+    };
+
+    temporaryFileReader.onload = () => {
+      resolve(temporaryFileReader.result);
+    };
+    temporaryFileReader.readAsArrayBuffer(inputFile);
+  });
+};
+
+// Inputs are pushed into the wasm heap in pieces of this size
+const INPUT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Push a File/Blob or Uint8Array into ctx, see begin_input in export.cpp.
+// Files are read slice by slice, so the whole model is never held in js.
+// Returns the address of the input in the wasm heap, which ctx owns.
+const pushInput = async (mdl, ctx, input) => {
+  let _begin_input = mdl.cwrap('begin_input', "number", ["number", "number"])
+  let _append_input = mdl.cwrap('append_input', "number", ["number", "number"])
+  let _end_input = mdl.cwrap('end_input', "number", ["number"])
+  const is_blob = (input instanceof Blob);
+  const size = is_blob ? input.size : input.length;
+  if (_begin_input(ctx, size) == 0) {
+    throw "Out of memory when loading the model";
+  }
+  for (var pos = 0; pos < size; pos += INPUT_CHUNK_SIZE) {
+    const end = Math.min(pos + INPUT_CHUNK_SIZE, size);
+    const chunk = is_blob ?
+      new Uint8Array(await readFileAsArrayBuffer(input.slice(pos, end))) :
+      input.subarray(pos, end);
+    const dst = _append_input(ctx, chunk.length);
+    if (dst == 0) {
+      // more than begin_input reserved, or a bad ctx
+      throw "Cannot append to the input of the model";
+    }
+    mdl.HEAPU8.set(chunk, dst);
+  }
+  return _end_input(ctx);
+}
+
+// inputs are Files/Blobs or Uint8Arrays
+const cpp_js_wrapper = async (mdl, export_name, inputs, extra_args, extra_types) => {
+  var ctx = mdl.ccall('create_exporter', 'number');
+  try {
+    var args = [ctx];
+    var arg_types = ["number"];
+    const n = inputs.length;
+    for (var i = 0; i < n; i++) {
+      const input = inputs[i];
+      const input_heap = await pushInput(mdl, ctx, input);
+      args.push(input_heap, (input instanceof Blob) ? input.size : input.length);
+      arg_types.push("number", "number");
+    }
+    const n2 = extra_args.length;
+    for (var i = 0; i < n2; i++) {
+      args.push(extra_args[i]);
+      arg_types.push(extra_types[i]);
+    }
+    const convert = mdl.cwrap(export_name, "number", arg_types);
+    const success = convert.apply(null, args);
+    if (success) {
+      ret = getConvertedModelsAndErrorMsg(mdl, ctx);
+    } else {
+      ret = getErrorMsg(mdl, ctx);
+    }
+    return [success, ret];
+  } finally {
+    mdl.ccall('free_exporter', null, ['number'], [ctx]);
+  }
+}
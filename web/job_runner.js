@@ -0,0 +1,152 @@
+// Runs the conversions in web workers (convert_worker.js) instead of on the
+// page, so that the page stays responsive during a conversion and several
+// conversions can run at once.
+//
+// Every worker hosts one module and keeps it loaded between jobs, so a
+// module is compiled once per worker, not once per conversion. Inputs and
+// outputs are moved between the page and the workers as transferable
+// ArrayBuffers instead of being copied by structured clone.
+
+const MAX_CONVERT_WORKERS = Math.max(1, navigator.hardwareConcurrency || 2);
+
+// The typed arrays in arrs whose buffers can be moved to a worker. A view
+// into a larger buffer is copied instead, moving it would detach the other
+// views of the buffer as well.
+const transferList = (arrs) => arrs
+    .filter((x) => ArrayBuffer.isView(x) && x.byteOffset == 0 &&
+                   x.byteLength == x.buffer.byteLength)
+    .map((x) => x.buffer);
+
+class JobRunner {
+  constructor(max_workers) {
+    this.max_workers = max_workers;
+    // [{module, worker, task}], task is the job being run, null if idle
+    this.workers = [];
+    // [{job, transfer, resolve, reject}] waiting for a worker
+    this.queue = [];
+    // module -> Promise of its warm up, see warmUp
+    this.warmed = new Map();
+    // module -> the result of its warm up, the time-to-ready of every module
+    // loaded so far
+    this.readyTimes = new Map();
+  }
+
+  spawn(module) {
+    const entry = {module: module, worker: new Worker('convert_worker.js'),
+                   task: null};
+    entry.worker.onmessage = (e) => this.finish(entry, e.data);
+    // e.g. a script of the module failed to load, or the worker ran out of
+    // memory
+    entry.worker.onerror = (e) => {
+      e.preventDefault();
+      this.workers.splice(this.workers.indexOf(entry), 1);
+      entry.worker.terminate();
+      this.finish(entry, {error: e.message || 'the worker of ' + module +
+                                                  ' crashed'});
+    };
+    this.workers.push(entry);
+    return entry;
+  }
+
+  // An idle worker of module, or a new one if there is room for it. When
+  // all workers are taken an idle worker of another module makes room.
+  // Returns null if every worker is busy.
+  acquire(module) {
+    const idle = this.workers.find((x) => x.task === null && x.module == module);
+    if (idle !== undefined) {
+      return idle;
+    }
+    if (this.workers.length >= this.max_workers) {
+      const i = this.workers.findIndex((x) => x.task === null);
+      if (i == -1) {
+        return null;
+      }
+      this.workers[i].worker.terminate();
+      this.workers.splice(i, 1);
+    }
+    return this.spawn(module);
+  }
+
+  dispatch() {
+    while (this.queue.length > 0) {
+      const entry = this.acquire(this.queue[0].job.module);
+      if (entry === null) {
+        return;
+      }
+      entry.task = this.queue.shift();
+      entry.worker.postMessage(entry.task.job, entry.task.transfer);
+    }
+  }
+
+  finish(entry, msg) {
+    const task = entry.task;
+    entry.task = null;
+    if (task !== null) {
+      if (msg.error !== undefined) {
+        task.reject(msg.error);
+      } else {
+        task.resolve(msg.result);
+      }
+    }
+    this.dispatch();
+  }
+
+  // Run a job of convert_worker.js in a worker of job.module. The buffers
+  // in transfer are moved to the worker and cannot be used afterwards.
+  run(job, transfer) {
+    return new Promise((resolve, reject) => {
+      this.queue.push({job: job, transfer: transfer, resolve: resolve,
+                       reject: reject});
+      this.dispatch();
+    });
+  }
+
+  // Load module ahead of the first job of it, in a worker or on the page
+  // for pthread builds (see runConverter). Resolves to {module, source,
+  // compile_ms, ready_ms} (see ModuleManager.load), ready_ms is the time
+  // from the first request until the module was ready.
+  warmUp(module) {
+    if (!this.warmed.has(module)) {
+      const start = performance.now();
+      const info = CONVERTER_MODULES[module];
+      const load = info !== undefined && info.threads ?
+          moduleManager.load(module) :
+          this.run({type: 'load', module: module}, []);
+      const loading = load.then((res) => {
+        res = Object.assign({ready_ms: performance.now() - start}, res);
+        console.log(module + ' ready in ' + res.ready_ms.toFixed(0) + ' ms (' +
+                    res.source + ')');
+        this.readyTimes.set(module, res);
+        return res;
+      });
+      this.warmed.set(module, loading);
+      loading.catch(() => this.warmed.delete(module));
+    }
+    return this.warmed.get(module);
+  }
+
+  // ModuleManager.run of converter name in a worker. The Uint8Arrays of
+  // inputs are moved there.
+  runConverter(name, inputs, args, output_paths) {
+    if (CONVERTER_MODULES[name].threads) {
+      // pthread builds start workers of their own, which browsers do not
+      // reliably allow from inside a worker, so they stay on the page
+      return moduleManager.run(name, inputs, args, output_paths);
+    }
+    const job = {type: 'main', module: name, inputs: inputs, args: args,
+                 outputs: output_paths};
+    return this.run(job, transferList(inputs.map((x) => x.data)));
+  }
+
+  // cpp_js_wrapper in a worker. Files are passed by reference, the
+  // Uint8Arrays of inputs are moved. module is 'export' (export.js) or an
+  // exporter module of module_manager.js.
+  runExport(export_name, inputs, extra_args, extra_types, module = 'export') {
+    const job = {type: 'export', module: module, export_name: export_name,
+                 inputs: inputs, extra_args: extra_args,
+                 extra_types: extra_types};
+    return this.run(job, transferList(inputs));
+  }
+}
+
+var jobRunner = new JobRunner(MAX_CONVERT_WORKERS);
@@ -0,0 +1,412 @@
+// Compiled converter modules and pre-warmed instances of them.
+//
+// Every conversion used to call create_onnx2ncnn(...) and friends afresh,
+// which downloads (or revalidates), compiles and instantiates a module of
+// several MB. Here the compiled WebAssembly.Module of every converter is
+// kept in memory, and its bytes in IndexedDB keyed by the hash of the build
+// (see module_hashes.json, written by tools/module_hashes.js), so that only
+// the first conversion after a deploy compiles from the network, and that
+// one compiles while downloading (WebAssembly.compileStreaming). Browsers
+// no longer store WebAssembly.Module itself in IndexedDB, hence the bytes.
+// The glue code of a module is only loaded once a conversion needs it.
+//
+// The converters are command line programs whose runtime exits after
+// callMain, so an instance cannot run twice. Instead a small pool of fresh
+// instances is instantiated from the cached module in the background after
+// every use, and the next conversion takes one that is ready.
+
+// The side modules a converter loads at startup in a WMC_SHARED_PROTOBUF
+// build (see cmake/shared_protobuf.cmake). They are only fetched here if
+// module_hashes.json lists them, i.e. if they are deployed.
+const PROTOBUF_SIDE_MODULES = ['libwmc_protobuf.wasm'];
+const ONNX_SIDE_MODULES = ['libwmc_protobuf.wasm', 'libwmc_onnx.wasm'];
+
+// Keep in sync with the EXPORT_NAME of the wrappers (*_wrapper/CMakeLists.txt).
+// script is the glue code defining the factory, see convert_worker.js.
+const CONVERTER_MODULES = {
+  onnxsim: {factory: 'create_onnxsim', script: 'onnxsim.js',
+            wasm: 'onnxsim.wasm'},
+  onnx2ncnn: {factory: 'create_onnx2ncnn', script: 'onnx2ncnn.js',
+              wasm: 'onnx2ncnn.wasm', side_modules: PROTOBUF_SIDE_MODULES},
+  caffe2ncnn: {factory: 'create_caffe2ncnn', script: 'caffe2ncnn.js',
+               wasm: 'caffe2ncnn.wasm', side_modules: PROTOBUF_SIDE_MODULES},
+  mxnet2ncnn: {factory: 'create_mxnet2ncnn', script: 'mxnet2ncnn.js',
+               wasm: 'mxnet2ncnn.wasm'},
+  darknet2ncnn: {factory: 'create_darknet2ncnn', script: 'darknet2ncnn.js',
+                 wasm: 'darknet2ncnn.wasm'},
+  mlir2ncnn: {factory: 'create_mlir2ncnn', script: 'mlir2ncnn.js',
+              wasm: 'mlir2ncnn.wasm'},
+  ncnnoptimize: {factory: 'create_ncnnoptimize', script: 'ncnnoptimize.js',
+                 wasm: 'ncnnoptimize.wasm'},
+  x2mnn: {factory: 'create_x2mnn', script: 'MNNConvert.js',
+          wasm: 'MNNConvert.wasm', side_modules: PROTOBUF_SIDE_MODULES},
+  // built with pthreads, an idle instance would hold a pool of workers, so
+  // they are not pre-warmed
+  x2tengine: {factory: 'create_x2tengine', script: 'tm_convert_tool.js',
+              wasm: 'tm_convert_tool.wasm', threads: true},
+  paddle_opt: {factory: 'create_paddle_opt', script: 'opt.js',
+               wasm: 'opt.wasm', threads: true},
+  // an exporter module like export.js (see exporter.js), one instance
+  // serves every conversion
+  onnx2ncnn_pipeline: {factory: 'create_onnx2ncnn_pipeline',
+                       script: 'onnx2ncnn_pipeline.js',
+                       wasm: 'onnx2ncnn_pipeline.wasm', exporter: true,
+                       side_modules: ONNX_SIDE_MODULES},
+};
+
+// Instances kept ready per converter once it has been used. Each one holds
+// the initial memory of its module (up to 128 MB), so keep this small.
+const MODULE_POOL_SIZE = 1;
+
+const MODULE_DB_NAME = 'wmc-modules';
+const MODULE_DB_STORE = 'wasm';
+
+const openModuleDb = () => new Promise((resolve, reject) => {
+  if (typeof indexedDB === 'undefined') {
+    reject(new Error('no IndexedDB'));
+    return;
+  }
+  const req = indexedDB.open(MODULE_DB_NAME, 1);
+  req.onupgradeneeded = () => req.result.createObjectStore(MODULE_DB_STORE);
+  req.onsuccess = () => resolve(req.result);
+  req.onerror = () => reject(req.error);
+});
+
+const dbRequest = (req) => new Promise((resolve, reject) => {
+  req.onsuccess = () => resolve(req.result);
+  req.onerror = () => reject(req.error);
+});
+
+class ModuleManager {
+  constructor() {
+    // name -> Promise of WebAssembly.Module, or of null if the module is
+    // left to load itself
+    this.compiled = new Map();
+    // name -> [entry], see instantiate
+    this.pools = new Map();
+    // name -> Promise of the glue code, see loadScript
+    this.scripts = new Map();
+    // name -> {module, source, compile_ms}, see load
+    this.loads = new Map();
+    // side module file -> Promise of an object url of it, or of null if it
+    // is left to the glue code, see sideModuleUrl
+    this.sideModules = new Map();
+    this.hashes = null;
+    this.db = null;
+  }
+
+  // wasm file name -> hash of its contents, empty if there is no
+  // module_hashes.json, which disables the IndexedDB cache
+  buildHashes() {
+    if (this.hashes === null) {
+      this.hashes = fetch('module_hashes.json', {cache: 'no-cache'})
+          .then((response) => response.ok ? response.json() : {})
+          .catch(() => ({}));
+    }
+    return this.hashes;
+  }
+
+  database() {
+    if (this.db === null) {
+      this.db = openModuleDb().catch((e) => {
+        console.log('module cache disabled: ' + e);
+        return null;
+      });
+    }
+    return this.db;
+  }
+
+  async loadBytes(key) {
+    const db = await this.database();
+    if (db === null) {
+      return null;
+    }
+    try {
+      const store = db.transaction(MODULE_DB_STORE).objectStore(MODULE_DB_STORE);
+      return (await dbRequest(store.get(key))) || null;
+    } catch (e) {
+      return null;
+    }
+  }
+
+  // replaces the bytes of older builds of the same module
+  async storeBytes(name, key, bytes) {
+    const db = await this.database();
+    if (db === null) {
+      return;
+    }
+    try {
+      const store = db.transaction(MODULE_DB_STORE, 'readwrite')
+                        .objectStore(MODULE_DB_STORE);
+      store.delete(IDBKeyRange.bound(name + '@', name + '@\uffff'));
+      await dbRequest(store.put(bytes, key));
+    } catch (e) {
+      // quota exceeded or private mode, the memory cache still works
+      console.log('cannot cache ' + name + ': ' + e);
+    }
+  }
+
+  // Forget the compiled module of name and its bytes, e.g. when they cannot
+  // be instantiated with the glue code of a new deploy
+  async evict(name) {
+    this.compiled.delete(name);
+    const db = await this.database();
+    if (db === null) {
+      return;
+    }
+    try {
+      const store = db.transaction(MODULE_DB_STORE, 'readwrite')
+                        .objectStore(MODULE_DB_STORE);
+      await dbRequest(
+          store.delete(IDBKeyRange.bound(name + '@', name + '@\uffff')));
+    } catch (e) {
+      console.log('cannot evict ' + name + ': ' + e);
+    }
+  }
+
+  // Compile while the module is downloaded, unless the server does not
+  // send it as application/wasm. Resolves to [module, bytes], bytes only if
+  // keep_bytes, for the IndexedDB cache.
+  async compileFromNetwork(wasm, keep_bytes) {
+    const response = await fetch(wasm);
+    if (!response.ok) {
+      throw new Error(wasm + ': ' + response.status);
+    }
+    const bytes = keep_bytes ? response.clone().arrayBuffer() : null;
+    if (typeof WebAssembly.compileStreaming === 'function') {
+      try {
+        return [await WebAssembly.compileStreaming(response), await bytes];
+      } catch (e) {
+        console.log('cannot compile ' + wasm + ' while downloading: ' + e);
+      }
+    }
+    const buf = bytes !== null ? await bytes :
+        await (response.bodyUsed ? await fetch(wasm) : response).arrayBuffer();
+    return [await WebAssembly.compile(buf), bytes !== null ? buf : null];
+  }
+
+  compile(name) {
+    if (!this.compiled.has(name)) {
+      const info = CONVERTER_MODULES[name];
+      const start = performance.now();
+      const loaded = (source) => {
+        this.loads.set(name, {module: name, source: source,
+                              compile_ms: performance.now() - start});
+      };
+      this.compiled.set(name, (async () => {
+        const hash = (await this.buildHashes())[info.wasm];
+        const key = name + '@' + hash;
+        const bytes = hash ? await this.loadBytes(key) : null;
+        if (bytes !== null) {
+          const compiled = await WebAssembly.compile(bytes);
+          loaded('cache');
+          return compiled;
+        }
+        const [compiled, downloaded] =
+            await this.compileFromNetwork(info.wasm, Boolean(hash));
+        loaded('network');
+        if (hash) {
+          this.storeBytes(name, key, downloaded);
+        }
+        return compiled;
+      })().catch((e) => {
+        // e.g. the wasm is not next to the page, the glue code knows better
+        console.log('loading ' + name + ' by itself: ' + e);
+        loaded('glue');
+        return null;
+      }));
+    }
+    return this.compiled.get(name);
+  }
+
+  // The bytes of a side module from the IndexedDB cache or the network, as
+  // an object url for locateFile. The glue code of every instance loads
+  // the side modules it needs by itself, this way they are downloaded once
+  // per build instead of being revalidated by every instance.
+  sideModuleUrl(file) {
+    if (!this.sideModules.has(file)) {
+      this.sideModules.set(file, (async () => {
+        const hash = (await this.buildHashes())[file];
+        if (!hash) {
+          return null;
+        }
+        const key = file + '@' + hash;
+        let bytes = await this.loadBytes(key);
+        if (bytes === null) {
+          const response = await fetch(file);
+          if (!response.ok) {
+            throw new Error(file + ': ' + response.status);
+          }
+          bytes = await response.arrayBuffer();
+          this.storeBytes(file, key, bytes);
+        }
+        return URL.createObjectURL(new Blob([bytes],
+                                            {type: 'application/wasm'}));
+      })().catch((e) => {
+        console.log('loading ' + file + ' by the glue code: ' + e);
+        return null;
+      }));
+    }
+    return this.sideModules.get(file);
+  }
+
+  // side module file -> object url, for the side modules of name that
+  // sideModuleUrl has
+  async sideModuleUrls(name) {
+    const files = CONVERTER_MODULES[name].side_modules || [];
+    const urls = await Promise.all(files.map((x) => this.sideModuleUrl(x)));
+    const res = {};
+    files.forEach((file, i) => {
+      if (urls[i] !== null) {
+        res[file] = urls[i];
+      }
+    });
+    return res;
+  }
+
+  // The glue code of a module, which defines its factory. Only the modules
+  // a conversion needs are loaded, when it needs them.
+  loadScript(name) {
+    if (!this.scripts.has(name)) {
+      const script = CONVERTER_MODULES[name].script;
+      const loading = typeof importScripts === 'function' ?
+          new Promise((resolve) => {
+            importScripts(script);
+            resolve();
+          }) :
+          new Promise((resolve, reject) => {
+            const element = document.createElement('script');
+            element.src = script;
+            element.onload = () => resolve();
+            element.onerror = () => reject(new Error('cannot load ' + script));
+            document.head.appendChild(element);
+          });
+      this.scripts.set(name, loading);
+      // a failed script is tried again by the next conversion
+      loading.catch(() => this.scripts.delete(name));
+    }
+    return this.scripts.get(name);
+  }
+
+  // The glue code and the compiled module, ahead of the first instance.
+  // Resolves to {module, source, compile_ms}, source is where the wasm came
+  // from: 'cache' (IndexedDB), 'network' or 'glue' (loaded by the glue code
+  // itself when it is instantiated).
+  async load(name) {
+    await Promise.all([this.loadScript(name), this.compile(name),
+                       this.sideModuleUrls(name)]);
+    return this.loads.get(name);
+  }
+
+  // A new instance whose print, printErr and onExit go to entry.handlers,
+  // which are set when the instance is handed out
+  async instantiate(name) {
+    const info = CONVERTER_MODULES[name];
+    const [compiled, side_modules] = await Promise.all([
+      this.compile(name), this.sideModuleUrls(name), this.loadScript(name)]);
+    const entry = {handlers: {}};
+    const settings = {
+      noInitialRun: true,
+      // everything is deployed next to the page, the side modules may be
+      // named by the path they were linked from
+      locateFile: (path, prefix) => {
+        const file = path.split('/').pop();
+        return side_modules[file] || prefix + file;
+      },
+      print: (text) => entry.handlers.print && entry.handlers.print(text),
+      printErr: (text) =>
+          entry.handlers.printErr && entry.handlers.printErr(text),
+      onExit: (status) =>
+          entry.handlers.onExit && entry.handlers.onExit(status),
+    };
+    // the factory does not settle when instantiateWasm fails, this rejects
+    // the instance instead
+    let fail;
+    const failed = new Promise((resolve, reject) => {fail = reject;});
+    if (compiled !== null) {
+      settings.instantiateWasm = (imports, callback) => {
+        const instantiate = (module) => WebAssembly.instantiate(module, imports)
+            .then((instance) => [instance, module]);
+        instantiate(compiled)
+            .catch((e) => {
+              // e.g. the imports of the glue code of a new deploy do not
+              // match, try the wasm on the server once
+              console.log('cannot instantiate ' + name + ' from the cache: ' +
+                          e);
+              this.evict(name);
+              return this.compileFromNetwork(info.wasm, false)
+                  .then(([module]) => instantiate(module));
+            })
+            .then(([instance, module]) => callback(instance, module), fail);
+        return {};
+      };
+    }
+    entry.module =
+        await Promise.race([globalThis[info.factory](settings), failed]);
+    return entry;
+  }
+
+  refill(name) {
+    const pool = this.pools.get(name);
+    while (pool.length + pool.pending < MODULE_POOL_SIZE) {
+      pool.pending++;
+      // after the conversion that is about to start has its instance
+      setTimeout(() => {
+        this.instantiate(name)
+            .then((entry) => pool.push(entry))
+            .catch((e) => console.log('cannot pre-warm ' + name + ': ' + e))
+            .finally(() => pool.pending--);
+      }, 0);
+    }
+  }
+
+  // A ready module for one callMain, like create_<name>(settings). Only the
+  // print, printErr and onExit of settings are used, noInitialRun is
+  // always set.
+  async create(name, settings) {
+    if (!this.pools.has(name)) {
+      const pool = [];
+      pool.pending = 0;
+      this.pools.set(name, pool);
+    }
+    const pool = this.pools.get(name);
+    const entry = pool.length > 0 ? pool.shift() : await this.instantiate(name);
+    entry.handlers = settings;
+    if (!CONVERTER_MODULES[name].threads) {
+      this.refill(name);
+    }
+    return entry.module;
+  }
+
+  // One conversion in a fresh instance: the inputs ([{path, data}]) are
+  // written to MEMFS, main is called with args and output_paths are read
+  // back. Returns {exit_status, outputs, log}, outputs are Uint8Arrays and
+  // empty unless the converter succeeded.
+  async run(name, inputs, args, output_paths) {
+    let exit_status = 0;
+    const log = [];
+    const print = (text) => {
+      console.log(text);
+      log.push(text);
+    };
+    const module = await this.create(name, {
+      print: print,
+      printErr: print,
+      onExit: (status) => {exit_status = status;},
+    });
+    for (const input of inputs) {
+      module.FS.writeFile(input.path, input.data);
+    }
+    module.callMain(args);
+    const outputs = exit_status == 0 ?
+        output_paths.map((path) => module.FS.readFile(path)) : [];
+    return {exit_status: exit_status, outputs: outputs, log: log};
+  }
+
+  // Load ahead of the first conversion, e.g. when a format is selected
+  prefetch(name) {
+    return this.load(name);
+  }
+}
+
+var moduleManager = new ModuleManager();
@@ -190,7 +190,11 @@ var vm = new Vue({
         showSuccessMsg: function () {return this.hasResult && this.convertSuccess},
     },
     watch: {
+        ncnnConvertWithOpt: function (newValue, oldValue) {
+            this.prepareModules();
+        },
         onnxSim: function (newValue, oldValue) {
+            this.prepareModules();
             if (newValue) {
                 onnxInferShapeBak = this.onnxInferShape;
                 this.onnxInferShape = true;
@@ -200,6 +204,7 @@ var vm = new Vue({
         },
         inputFormat: function (newValue, oldValue) {
             console.log(newValue);
+            this.prepareModules();
             console.log(this.fileList);
             this.fileList = [];
             this.convertDisabled = this.fileList.length != this.dqxlimit;
@@ -209,6 +214,7 @@ var vm = new Vue({
         },
         outputFormat: function (newValue, oldValue) {
             console.log(newValue);
+            this.prepareModules();
             this.fileList = [];
             this.hasResult = false;
             this.showShapeInputBox = false;
@@ -231,6 +237,29 @@ var vm = new Vue({
         },
     },
     methods: {
+        // Load the converters of the selected formats, the conversion waits
+        // for the first of them (see prepare_conversion in convert.js)
+        prepareModules() {
+            // the formats of the url are applied before convert.js is
+            // loaded, index.html calls this again afterwards
+            if (typeof prepare_conversion === 'undefined') {
+                return;
+            }
+            const selection = [this.outputFormat, this.inputFormat, this.onnxSim, this.ncnnConvertWithOpt];
+            const selected = () => selection.join() == [this.outputFormat, this.inputFormat, this.onnxSim, this.ncnnConvertWithOpt].join();
+            this.wasmDownloaded = false;
+            prepare_conversion(...selection).then(() => {
+                if (selected()) {
+                    this.wasmDownloaded = true;
+                }
+            }, (e) => {
+                console.log(e);
+                // let the conversion load the modules again and report the error
+                if (selected()) {
+                    this.wasmDownloaded = true;
+                }
+            });
+        },
         submitUpload() {
             if (!this.wasmDownloaded) {
                 this.$message({
@@ -288,7 +317,12 @@ var vm = new Vue({
             try {
                 const files = this.$refs.select.uploadFiles.map(file => file.raw);
                 const func = func_dict[this.outputFormat][this.inputFormat];
+                // these converters stream the files into the wasm heap by themselves
+                const takes_files = (this.outputFormat == 'tnn');
                 const convert_from_file = async (files) => {
+                    if (takes_files) {
+                        return func(order_input_files(files));
+                    }
                     uint8_arrs = await files_to_uint8_arrs(files);
                     return func(uint8_arrs);
                 }